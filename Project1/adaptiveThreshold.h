@@ -0,0 +1,246 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "sampleKernel.h"   // SIMD 检测宏
+
+// 局部自适应二值化：屏幕亮度不均、镜头暗角时全局阈值 128 会把暗处的白模块判成黑色，
+// 这里按局部的黑白电平求阈值，使小模块在这类画面中仍能可靠采样。
+// 1. 图像按 B x B 像素分块（B 取短边的 1/ADAPTIVE_BLOCKS），求各块均值，再以均值为界求块内亮、暗两部分的均值，
+//    作为该块的白电平和黑电平（噪声对两者的影响对称，中点不偏）；
+// 2. 块内电平差小于 ADAPTIVE_MIN_CONTRAST 的块（大片纯白或纯黑）不参与；其余块以电平差为权重，
+//    用块级积分图求周围 (2R+1) x (2R+1) 块的加权电平中点，作为该块中心的阈值；邻域内没有可用块时退回全局阈值 128；
+// 3. 各块阈值先沿水平方向插值展开成整行，逐像素行再做竖直插值并比较，输出与 threshold() 相同的 0 / 255 二值图。
+// 全部为整数运算，第 1、3 步按块行并行；未经缩放的干净帧只有 0 和 255 两种灰度，结果与全局阈值相同
+
+const int ADAPTIVE_BLOCKS = 48;        // 短边上的块数
+const int ADAPTIVE_MIN_BLOCK = 8;      // 最小块边长（像素）
+const int ADAPTIVE_MAX_BLOCK = 257;    // 最大块边长：块内按列累加用 16 位整数
+const int ADAPTIVE_RADIUS = 2;         // 邻域半径（块）
+const int ADAPTIVE_MIN_CONTRAST = 40;  // 参与求阈值的最小块内电平差
+
+// 块内按列累加：sums[x] += row[x]
+inline void accumulateColumns(const uint8_t* row, uint16_t* sums, int cols) {
+    int x = 0;
+#ifdef SAMPLE_KERNEL_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 16 <= cols; x += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(row + x));
+        __m128i* out = (__m128i*)(sums + x);
+        _mm_storeu_si128(out, _mm_add_epi16(_mm_loadu_si128(out), _mm_unpacklo_epi8(v, zero)));
+        _mm_storeu_si128(out + 1, _mm_add_epi16(_mm_loadu_si128(out + 1), _mm_unpackhi_epi8(v, zero)));
+    }
+#endif
+    for (; x < cols; ++x) {
+        sums[x] += row[x];
+    }
+}
+
+// 按列累加亮于所在块均值的像素：row[x] > means[x] 时 sums[x] += row[x]、counts[x] += 1
+inline void accumulateBright(const uint8_t* row, const uint8_t* means, uint16_t* sums, uint16_t* counts, int cols) {
+    int x = 0;
+#ifdef SAMPLE_KERNEL_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi8(-1);
+    for (; x + 16 <= cols; x += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(row + x));
+        __m128i m = _mm_loadu_si128((const __m128i*)(means + x));
+        // 无符号 v > m 等价于饱和减法 v - m 非零；bright 为 0xFF / 0x00
+        __m128i bright = _mm_xor_si128(_mm_cmpeq_epi8(_mm_subs_epu8(v, m), zero), ones);
+        __m128i value = _mm_and_si128(v, bright);
+        __m128i* sumOut = (__m128i*)(sums + x);
+        __m128i* countOut = (__m128i*)(counts + x);
+        _mm_storeu_si128(sumOut, _mm_add_epi16(_mm_loadu_si128(sumOut), _mm_unpacklo_epi8(value, zero)));
+        _mm_storeu_si128(sumOut + 1, _mm_add_epi16(_mm_loadu_si128(sumOut + 1), _mm_unpackhi_epi8(value, zero)));
+        // 掩码扩展为 16 位后为 -1 / 0，减去即计数加 1
+        _mm_storeu_si128(countOut, _mm_sub_epi16(_mm_loadu_si128(countOut), _mm_unpacklo_epi8(bright, bright)));
+        _mm_storeu_si128(countOut + 1, _mm_sub_epi16(_mm_loadu_si128(countOut + 1), _mm_unpackhi_epi8(bright, bright)));
+    }
+#endif
+    for (; x < cols; ++x) {
+        bool bright = row[x] > means[x];
+        sums[x] += bright ? row[x] : 0;
+        counts[x] += bright;
+    }
+}
+
+// 一行二值化：阈值为上下两个展开行按权重（和为 256）插值，像素大于阈值时输出 255；加权和不超过 16 位
+inline void binarizeRow(const uint8_t* in, const uint8_t* upper, const uint8_t* lower, int lowerWeight,
+    uint8_t* out, int cols) {
+    int x = 0;
+#ifdef SAMPLE_KERNEL_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi8(-1);
+    const __m128i upperScale = _mm_set1_epi16((short)(256 - lowerWeight));
+    const __m128i lowerScale = _mm_set1_epi16((short)lowerWeight);
+    const __m128i round = _mm_set1_epi16(128);
+    for (; x + 16 <= cols; x += 16) {
+        __m128i u = _mm_loadu_si128((const __m128i*)(upper + x));
+        __m128i l = _mm_loadu_si128((const __m128i*)(lower + x));
+        __m128i low = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(u, zero), upperScale),
+            _mm_mullo_epi16(_mm_unpacklo_epi8(l, zero), lowerScale)), round);
+        __m128i high = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(u, zero), upperScale),
+            _mm_mullo_epi16(_mm_unpackhi_epi8(l, zero), lowerScale)), round);
+        __m128i threshold = _mm_packus_epi16(_mm_srli_epi16(low, 8), _mm_srli_epi16(high, 8));
+        __m128i v = _mm_loadu_si128((const __m128i*)(in + x));
+        __m128i dark = _mm_cmpeq_epi8(_mm_subs_epu8(v, threshold), zero);
+        _mm_storeu_si128((__m128i*)(out + x), _mm_xor_si128(dark, ones));
+    }
+#endif
+    uint16_t upperWeight = (uint16_t)(256 - lowerWeight);
+    uint16_t weight = (uint16_t)lowerWeight;
+    for (; x < cols; ++x) {
+        uint8_t threshold = (uint8_t)((uint16_t)(upper[x] * upperWeight + lower[x] * weight + 128) >> 8);
+        out[x] = (in[x] > threshold) ? 255 : 0;
+    }
+}
+
+class AdaptiveBinarizer {
+public:
+    // gray 为单通道 8 位图像，binary 按需分配（不能与 gray 共享数据）
+    void apply(const cv::Mat& gray, cv::Mat& binary) {
+        int rows = gray.rows;
+        int cols = gray.cols;
+        block = std::min(std::max(ADAPTIVE_MIN_BLOCK, std::min(rows, cols) / ADAPTIVE_BLOCKS), ADAPTIVE_MAX_BLOCK);
+        blocksX = (cols + block - 1) / block;
+        blocksY = (rows + block - 1) / block;
+
+        computeBlockLevels(gray);
+        computeBlockThresholds();
+        expandThresholdRows(cols);
+
+        binary.create(rows, cols, CV_8UC1);
+        cv::parallel_for_(cv::Range(0, blocksY), [&](const cv::Range& range) {
+            for (int y = range.start * block; y < std::min(rows, range.end * block); ++y) {
+                // 第 y 行的阈值为上下两个块行展开结果的竖直插值
+                int pos = (2 * y + 1 - block) * 128 / block;
+                int by = std::min(std::max(pos >> 8, 0), blocksY - 1);
+                int weight = (pos < 0) ? 0 : std::min(pos - (by << 8), 256);
+                int next = std::min(by + 1, blocksY - 1);
+                binarizeRow(gray.ptr<uint8_t>(y), &thresholdRows[(size_t)by * cols], &thresholdRows[(size_t)next * cols],
+                    weight, binary.ptr<uint8_t>(y), cols);
+            }
+        });
+    }
+
+private:
+    // 第 1 步：各块的均值，以及以均值为界的白电平、黑电平（按块行并行，每个块行只写自己的一行块）。
+    // 块内的行先按列累加（整行连续访问，便于向量化），再按块合并各列
+    void computeBlockLevels(const cv::Mat& gray) {
+        size_t blocks = (size_t)blocksX * blocksY;
+        whiteLevels.resize(blocks);
+        blackLevels.resize(blocks);
+        int cols = gray.cols;
+        cv::parallel_for_(cv::Range(0, blocksY), [&](const cv::Range& range) {
+            std::vector<uint16_t> columnSums(cols), brightColumnSums(cols), brightColumnCounts(cols);
+            std::vector<uint8_t> columnMeans(cols);
+            std::vector<uint32_t> sums(blocksX);
+            for (int by = range.start; by < range.end; ++by) {
+                int y0 = by * block;
+                int y1 = std::min(gray.rows, y0 + block);
+
+                std::fill(columnSums.begin(), columnSums.end(), 0);
+                for (int y = y0; y < y1; ++y) {
+                    accumulateColumns(gray.ptr<uint8_t>(y), columnSums.data(), cols);
+                }
+                for (int bx = 0; bx < blocksX; ++bx) {
+                    int x0 = bx * block;
+                    int x1 = std::min(cols, x0 + block);
+                    uint32_t sum = 0;
+                    for (int x = x0; x < x1; ++x) {
+                        sum += columnSums[x];
+                    }
+                    uint32_t area = (uint32_t)(x1 - x0) * (y1 - y0);
+                    sums[bx] = sum;
+                    std::fill(columnMeans.begin() + x0, columnMeans.begin() + x1, (uint8_t)((sum + area / 2) / area));
+                }
+
+                std::fill(brightColumnSums.begin(), brightColumnSums.end(), 0);
+                std::fill(brightColumnCounts.begin(), brightColumnCounts.end(), 0);
+                for (int y = y0; y < y1; ++y) {
+                    accumulateBright(gray.ptr<uint8_t>(y), columnMeans.data(), brightColumnSums.data(),
+                        brightColumnCounts.data(), cols);
+                }
+                for (int bx = 0; bx < blocksX; ++bx) {
+                    int x0 = bx * block;
+                    int x1 = std::min(cols, x0 + block);
+                    uint32_t brightSum = 0, brightCount = 0;
+                    for (int x = x0; x < x1; ++x) {
+                        brightSum += brightColumnSums[x];
+                        brightCount += brightColumnCounts[x];
+                    }
+                    uint32_t darkCount = (uint32_t)(x1 - x0) * (y1 - y0) - brightCount;
+                    uint8_t mean = columnMeans[x0];
+                    size_t i = (size_t)by * blocksX + bx;
+                    whiteLevels[i] = brightCount ? (uint8_t)(brightSum / brightCount) : mean;
+                    blackLevels[i] = darkCount ? (uint8_t)((sums[bx] - brightSum) / darkCount) : mean;
+                }
+            }
+        });
+    }
+
+    // 第 2 步：以电平差为权重的电平中点（白 + 黑）及权重的块级积分图，求每块邻域的加权中点
+    void computeBlockThresholds() {
+        size_t stride = (size_t)blocksX + 1;
+        weightedLevels.assign(stride * (blocksY + 1), 0);
+        weights.assign(stride * (blocksY + 1), 0);
+        for (int by = 0; by < blocksY; ++by) {
+            uint64_t levelRow = 0, weightRow = 0;
+            for (int bx = 0; bx < blocksX; ++bx) {
+                size_t i = (size_t)by * blocksX + bx;
+                int contrast = whiteLevels[i] - blackLevels[i];
+                if (contrast >= ADAPTIVE_MIN_CONTRAST) {
+                    levelRow += (uint64_t)contrast * (whiteLevels[i] + blackLevels[i]);
+                    weightRow += (uint64_t)contrast;
+                }
+                size_t at = (by + 1) * stride + bx + 1;
+                weightedLevels[at] = weightedLevels[at - stride] + levelRow;
+                weights[at] = weights[at - stride] + weightRow;
+            }
+        }
+
+        blockThresholds.resize((size_t)blocksX * blocksY);
+        for (int by = 0; by < blocksY; ++by) {
+            size_t y0 = (size_t)std::max(0, by - ADAPTIVE_RADIUS) * stride;
+            size_t y1 = (size_t)(std::min(blocksY - 1, by + ADAPTIVE_RADIUS) + 1) * stride;
+            for (int bx = 0; bx < blocksX; ++bx) {
+                size_t x0 = std::max(0, bx - ADAPTIVE_RADIUS);
+                size_t x1 = std::min(blocksX - 1, bx + ADAPTIVE_RADIUS) + 1;
+                uint64_t weight = weights[y1 + x1] - weights[y0 + x1] - weights[y1 + x0] + weights[y0 + x0];
+                uint64_t level = weightedLevels[y1 + x1] - weightedLevels[y0 + x1] -
+                    weightedLevels[y1 + x0] + weightedLevels[y0 + x0];
+                blockThresholds[(size_t)by * blocksX + bx] = weight ? (uint8_t)((level + weight) / (2 * weight)) : 128;
+            }
+        }
+    }
+
+    // 第 3 步（逐像素行的竖直插值与比较见 apply / binarizeRow）：每个块行的阈值在块中心之间水平线性插值，展开为整行
+    void expandThresholdRows(int cols) {
+        thresholdRows.resize((size_t)blocksY * cols);
+        for (int by = 0; by < blocksY; ++by) {
+            const uint8_t* centers = &blockThresholds[(size_t)by * blocksX];
+            uint8_t* row = &thresholdRows[(size_t)by * cols];
+            for (int x = 0; x < cols; ++x) {
+                // 块中心位于 bx * block + block / 2，权重以 1/256 为单位
+                int pos = (2 * x + 1 - block) * 128 / block;
+                int bx = std::min(std::max(pos >> 8, 0), blocksX - 1);
+                int weight = (pos < 0) ? 0 : std::min(pos - (bx << 8), 256);
+                int next = std::min(bx + 1, blocksX - 1);
+                row[x] = (uint8_t)((centers[bx] * (256 - weight) + centers[next] * weight + 128) >> 8);
+            }
+        }
+    }
+
+    int block = 0;
+    int blocksX = 0;
+    int blocksY = 0;
+    std::vector<uint8_t> whiteLevels;
+    std::vector<uint8_t> blackLevels;
+    std::vector<uint64_t> weightedLevels;   // 块级积分图
+    std::vector<uint64_t> weights;
+    std::vector<uint8_t> blockThresholds;
+    std::vector<uint8_t> thresholdRows;
+};
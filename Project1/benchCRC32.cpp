@@ -0,0 +1,72 @@
+#include "crc32.h"
+
+#include <iostream>
+#include <random>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+
+using namespace std;
+
+// CRC32 微基准：比较逐位、slicing-by-8、PCLMULQDQ 及自动分派的吞吐量
+
+// 重复计算直到耗时足够，返回 MB/s
+double measure(const function<uint32_t(uint32_t, const uint8_t*, size_t)>& crcFunc,
+    const vector<uint8_t>& data, uint32_t& result) {
+    int rounds = 0;
+    double seconds = 0;
+    auto start = chrono::steady_clock::now();
+    do {
+        result = crcFunc(0, data.data(), data.size());
+        rounds++;
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    } while (seconds < 0.5);
+    return data.size() * (double)rounds / seconds / (1024.0 * 1024.0);
+}
+
+int main(int argc, char** argv) {
+    size_t size = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 10 * 1024 * 1024; // 默认 10MB
+
+    vector<uint8_t> data(size);
+    mt19937 gen(12345);
+    uniform_int_distribution<int> distrib(0, 255);
+    for (auto& byte : data) {
+        byte = static_cast<uint8_t>(distrib(gen));
+    }
+
+    uint32_t reference;
+    double bitwiseSpeed = measure(crc32Bitwise, data, reference);
+    cout << "bitwise:       " << bitwiseSpeed << " MB/s (crc " << hex << reference << dec << ")" << endl;
+
+    bool allMatch = true;
+    auto report = [&](const char* name, const function<uint32_t(uint32_t, const uint8_t*, size_t)>& crcFunc) {
+        uint32_t crc;
+        double speed = measure(crcFunc, data, crc);
+        allMatch = allMatch && (crc == reference);
+        cout << name << speed << " MB/s (x" << speed / bitwiseSpeed << ")"
+            << (crc == reference ? "" : " MISMATCH") << endl;
+    };
+
+    report("slicing-by-8:  ", crc32SliceBy8);
+#ifdef CRC32_HAVE_X86
+    if (crc32CpuHasPclmul()) {
+        report("pclmulqdq:     ", crc32Pclmul);
+    }
+    else {
+        cout << "pclmulqdq:     not supported by this CPU" << endl;
+    }
+#endif
+    report("crc32Update:   ", [](uint32_t crc, const uint8_t* p, size_t n) { return crc32Update(crc, p, n); });
+
+    // 增量接口：按 4KB 分块计算应与整体结果一致
+    uint32_t chunked = 0;
+    for (size_t offset = 0; offset < data.size(); offset += 4096) {
+        chunked = crc32Update(chunked, data.data() + offset, min<size_t>(4096, data.size() - offset));
+    }
+    allMatch = allMatch && (chunked == reference);
+    cout << "chunked (4KB): " << (chunked == reference ? "match" : "MISMATCH") << endl;
+
+    return allMatch ? 0 : 1;
+}
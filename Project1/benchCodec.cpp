@@ -0,0 +1,399 @@
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <vector>
+#include <string>
+#include <bitset>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "codec.h"
+#include "crc32.h"
+#include "channel.h"
+#include "modulation.h"
+
+using namespace cv;
+using namespace std;
+
+// 编解码吞吐量基准：在进程内完成 编码 → 模拟信道（见 channel.h） → 解码 的往返，
+// 遍历负载大小、模块大小、线程数和信道模型的所有组合，每个组合输出一行 JSON（JSON Lines），
+// 便于脚本比较回归和参数取舍。各字段：
+//   repeat                                    每帧经信道拍摄的次数（发送端每帧保持 repeat 个刷新周期）
+//   frames / frames_located / frames_decoded  帧数、定位成功的拍摄次数、数据块完全正确的帧数
+//   bits_compared / bit_errors / ber          定位成功的拍摄中纠错前的信道误码（融合后的采样比特与编码器写入比特之比较）；
+//                                             帧已正确送达后的重复拍摄不再解码
+//   encode_ms / channel_ms / sample_ms / correct_ms  各级每帧平均耗时
+//   encode_mbps / decode_mbps                 负载字节数除以编码、解码（采样 + 纠错）耗时，MB = 10^6 字节
+//   goodput_mbps                              正确送达的负载字节数除以编码与解码总耗时（不含信道模拟）
+//   ok                                        所有帧都正确送达
+
+struct BenchResult {
+    size_t frames = 0;
+    size_t located = 0;
+    size_t decoded = 0;
+    size_t bitsCompared = 0;
+    size_t bitErrors = 0;
+    size_t deliveredBytes = 0;
+    double encodeSeconds = 0;
+    double channelSeconds = 0;
+    double sampleSeconds = 0;
+    double correctSeconds = 0;
+    string error;
+};
+
+// 两段比特流前 count 位中不同的位数
+size_t countBitErrors(const BitStream& a, const BitStream& b, size_t count) {
+    size_t errors = 0;
+    size_t words = count / 64;
+    for (size_t w = 0; w < words; ++w) {
+        errors += bitset<64>(a.data()[w] ^ b.data()[w]).count();
+    }
+    size_t rest = count % 64;
+    if (rest > 0) {
+        errors += bitset<64>(a.readBits(words * 64, (int)rest) ^ b.readBits(words * 64, (int)rest)).count();
+    }
+    return errors;
+}
+
+inline double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// 一次往返：stream 为负载加 4 字节校验码，按顺序帧编码
+// 每帧经信道拍摄 repeat 次，同一帧的各次拍摄按 FrameFusion 融合后纠错
+BenchResult runBench(const vector<uint8_t>& stream, size_t payloadBytes, const EncoderConfig& config,
+    const ChannelModel& channel, int erasureThreshold, int repeat) {
+    BenchResult result;
+    Encoder encoder;
+    if (!encoder.configure(config)) {
+        result.error = "frame resolution too small";
+        return result;
+    }
+    Decoder decoder(erasureThreshold);
+    FrameFusion fusion;
+
+    size_t chunkSize = encoder.chunkBytes();
+    uint32_t totalFrames = (uint32_t)((stream.size() + chunkSize - 1) / chunkSize);
+    result.frames = totalFrames;
+
+    // 各帧写入的比特，按解码器读出的帧序号比较（H.264 信道可能丢帧或重复帧）
+    vector<BitStream> sentBits(totalFrames);
+    vector<bool> delivered(totalFrames, false);
+    SampledFrame sampled;
+    FrameHeader header;
+    vector<uint8_t> chunk;
+
+    auto decodeOne = [&](const Mat& image) {
+        auto start = chrono::steady_clock::now();
+        bool located = decoder.sample(image, sampled);
+        result.sampleSeconds += secondsSince(start);
+        if (!located || sampled.descriptor.seq >= totalFrames) {
+            return;
+        }
+        result.located++;
+        if (delivered[sampled.descriptor.seq]) {
+            return;
+        }
+        start = chrono::steady_clock::now();
+        fusion.add(sampled);
+        result.sampleSeconds += secondsSince(start);
+        const BitStream& sent = sentBits[sampled.descriptor.seq];
+        size_t count = min(sent.size(), sampled.bits.size());
+        result.bitsCompared += count;
+        result.bitErrors += countBitErrors(sent, sampled.bits, count);
+
+        start = chrono::steady_clock::now();
+        bool corrected = decoder.correct(sampled, header, chunk);
+        result.correctSeconds += secondsSince(start);
+        if (!corrected || header.fountain || header.seq >= totalFrames || delivered[header.seq]) {
+            return;
+        }
+        size_t offset = (size_t)header.seq * chunkSize;
+        if (chunk.size() == min(chunkSize, stream.size() - offset) &&
+            memcmp(chunk.data(), stream.data() + offset, chunk.size()) == 0) {
+            delivered[header.seq] = true;
+            result.decoded++;
+            result.deliveredBytes += min(offset + chunk.size(), payloadBytes) - min(offset, payloadBytes);
+        }
+    };
+
+    H264Channel video;
+    bool videoOpened = false;
+    Mat frame, received;
+    for (uint32_t seq = 0; seq < totalFrames; ++seq) {
+        header = FrameHeader();
+        header.seq = seq;
+        header.total = totalFrames;
+        size_t offset = (size_t)seq * chunkSize;
+        header.length = (uint32_t)min(chunkSize, stream.size() - offset);
+
+        auto start = chrono::steady_clock::now();
+        encoder.encodeFrame(header, stream.data() + offset, frame);
+        result.encodeSeconds += secondsSince(start);
+        sentBits[seq] = encoder.frameBits();
+
+        for (int capture = 0; capture < repeat; ++capture) {
+            start = chrono::steady_clock::now();
+            applyChannel(channel, frame, received);
+            if (channel.videoStage()) {
+                if (!videoOpened) {
+                    char path[64];
+                    snprintf(path, sizeof(path), "benchCodec_%u.mp4", (unsigned)rand());
+                    if (!video.open(path, received.size(), received.channels() == 3, channel.stages.back().amount)) {
+                        result.error = "H.264 encoder not available";
+                        return result;
+                    }
+                    videoOpened = true;
+                }
+                video.write(received);
+                result.channelSeconds += secondsSince(start);
+                continue;
+            }
+            result.channelSeconds += secondsSince(start);
+            decodeOne(received);
+        }
+    }
+
+    if (videoOpened) {
+        auto start = chrono::steady_clock::now();
+        bool reading = video.finish();
+        result.channelSeconds += secondsSince(start);
+        while (reading) {
+            start = chrono::steady_clock::now();
+            reading = video.read(received);
+            result.channelSeconds += secondsSince(start);
+            if (reading) {
+                decodeOne(received);
+            }
+        }
+    }
+    return result;
+}
+
+// 解析 64K、1M、10M 或字节数
+size_t parseSize(const string& text) {
+    char* end = nullptr;
+    double value = strtod(text.c_str(), &end);
+    if (end && (*end == 'K' || *end == 'k')) {
+        value *= 1024;
+    }
+    else if (end && (*end == 'M' || *end == 'm')) {
+        value *= 1024 * 1024;
+    }
+    return (size_t)value;
+}
+
+// 按逗号切分选项列表
+vector<string> splitList(const string& text) {
+    vector<string> items;
+    stringstream ss(text);
+    string item;
+    while (getline(ss, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+// JSON 字符串转义（信道描述等来自命令行）
+string jsonString(const string& text) {
+    string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+int main(int argc, char** argv) {
+    int frameWidth = 1920, frameHeight = 1080;
+    int rsDataBytes = 223;
+    int bitsPerModule = 1;
+    int erasureThreshold = DEFAULT_ERASURE_THRESHOLD;
+    int repeat = 1;
+    unsigned seed = 12345;
+    bool verbose = false;
+    string inputFile, outputFile;
+    vector<string> payloads = { "1M" };
+    vector<string> moduleSizes = { to_string(MODULE_SIZE) };
+    vector<string> threadCounts = { "1" };
+    if (getNumberOfCPUs() > 1) {
+        threadCounts.push_back(to_string(getNumberOfCPUs()));   // 单核机器上不重复跑同一组合
+    }
+    // 默认信道含 5% 梯形透视：不带参数运行即可检查透视校正是否回退（任一组合失败时返回 1）
+    vector<string> channels = { "none", "perspective:0.05" };
+
+    bool usage = false;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--frame" && hasValue) {
+            usage |= sscanf(argv[++i], "%dx%d", &frameWidth, &frameHeight) != 2;
+        }
+        else if (arg == "--payload" && hasValue) {
+            payloads = splitList(argv[++i]);
+        }
+        else if (arg == "--input" && hasValue) {
+            inputFile = argv[++i];
+        }
+        else if (arg == "--module-size" && hasValue) {
+            moduleSizes = splitList(argv[++i]);
+        }
+        else if (arg == "--threads" && hasValue) {
+            threadCounts = splitList(argv[++i]);
+        }
+        else if (arg == "--channel" && hasValue) {
+            channels = splitList(argv[++i]);
+        }
+        else if (arg == "--rs" && hasValue) {
+            rsDataBytes = atoi(argv[++i]);
+        }
+        else if (arg == "--bits-per-module" && hasValue) {
+            bitsPerModule = atoi(argv[++i]);
+        }
+        else if (arg == "--erasure-threshold" && hasValue) {
+            erasureThreshold = atoi(argv[++i]);
+        }
+        else if (arg == "--repeat" && hasValue) {
+            repeat = atoi(argv[++i]);
+        }
+        else if (arg == "--seed" && hasValue) {
+            seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--output" && hasValue) {
+            outputFile = argv[++i];
+        }
+        else if (arg == "--verbose") {
+            verbose = true;
+        }
+        else {
+            usage = true;
+        }
+    }
+
+    vector<ChannelModel> channelModels(channels.size());
+    for (size_t i = 0; i < channels.size(); ++i) {
+        if (!parseChannel(channels[i], channelModels[i])) {
+            cerr << "Error: Invalid channel " << channels[i] << endl;
+            usage = true;
+        }
+    }
+    if (usage || rsDataBytes < 0 || rsDataBytes > 254 || bitsPerModule < 1 || bitsPerModule > MAX_BITS_PER_MODULE ||
+        repeat < 1) {
+        cerr << "Usage: benchCodec [--frame WxH] [--payload 64K,1M,...] [--input file] [--module-size S,...]\n";
+        cerr << "                  [--threads N,...] [--channel C,...] [--rs K] [--bits-per-module B]\n";
+        cerr << "                  [--erasure-threshold T] [--repeat N] [--seed N] [--output results.jsonl] [--verbose]\n";
+        cerr << "       --repeat: capture every frame N times through the channel and fuse the captures\n";
+        cerr << "       --input: use the file (e.g. random_data.bin from test.cpp) instead of --payload\n";
+        cerr << "       --channel: none, or stages joined by '+': noise:S, blur:S, jpeg:Q, scale:F,\n";
+        cerr << "                  perspective:A, vignette:A, barrel:K, h264:Q (last),\n";
+        cerr << "                  e.g. scale:0.9+blur:1+noise:4+jpeg:85\n";
+        cerr << "                  (default none,perspective:0.05)\n";
+        cerr << "       One JSON object per configuration is written to stdout or --output; the exit code is 1\n";
+        cerr << "       when any configuration does not deliver every frame.\n";
+        return 1;
+    }
+
+    // 负载：随机字节（与 test.cpp 相同的生成方式）或指定文件
+    vector<vector<uint8_t>> payloadData;
+    if (!inputFile.empty()) {
+        ifstream ifs(inputFile, ios::binary);
+        payloadData.emplace_back(istreambuf_iterator<char>(ifs), istreambuf_iterator<char>());
+        if (payloadData.back().empty()) {
+            cerr << "Error: Could not read input file or file is empty" << endl;
+            return 1;
+        }
+    }
+    else {
+        mt19937 gen(seed);
+        uniform_int_distribution<int> distrib(0, 255);
+        for (const string& size : payloads) {
+            payloadData.emplace_back(parseSize(size));
+            for (auto& byte : payloadData.back()) {
+                byte = static_cast<uint8_t>(distrib(gen));
+            }
+        }
+    }
+
+    ofstream outputStream;
+    if (!outputFile.empty()) {
+        outputStream.open(outputFile);
+        if (!outputStream) {
+            cerr << "Error: Could not open " << outputFile << endl;
+            return 1;
+        }
+    }
+    ostream results(outputFile.empty() ? cout.rdbuf() : outputStream.rdbuf());
+
+    // 编解码库的摘要日志与结果分开：默认关闭，--verbose 时写到标准错误
+    setLogLevel(verbose ? LOG_SUMMARY : LOG_QUIET);
+    setLogStream(cerr);
+
+    size_t runs = payloadData.size() * moduleSizes.size() * threadCounts.size() * channelModels.size();
+    size_t run = 0;
+    bool allOk = true;
+    for (const vector<uint8_t>& payload : payloadData) {
+        // 校验码随最后一帧发送（与 encode 命令相同）
+        vector<uint8_t> stream = payload;
+        uint32_t checksum = crc32Update(0, payload);
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            stream.push_back((uint8_t)(checksum >> shift));
+        }
+
+        for (const string& moduleSize : moduleSizes) {
+            for (const string& threads : threadCounts) {
+                for (const ChannelModel& channel : channelModels) {
+                    EncoderConfig config;
+                    config.frameWidth = frameWidth;
+                    config.frameHeight = frameHeight;
+                    config.moduleSize = atoi(moduleSize.c_str());
+                    config.rsParity = (rsDataBytes > 0) ? 255 - rsDataBytes : 0;
+                    config.bitsPerModule = bitsPerModule;
+                    setNumThreads(atoi(threads.c_str()));
+
+                    cerr << "[" << ++run << "/" << runs << "] payload " << payload.size() << " B, module "
+                        << config.moduleSize << " px, " << getNumThreads() << " threads, channel " << channel.name << endl;
+                    BenchResult r = runBench(stream, payload.size(), config, channel, erasureThreshold, repeat);
+
+                    double decodeSeconds = r.sampleSeconds + r.correctSeconds;
+                    double frames = (double)max<size_t>(r.frames, 1);
+                    bool ok = r.error.empty() && r.decoded == r.frames;
+                    allOk = allOk && ok;
+                    results << "{\"payload_bytes\":" << payload.size()
+                        << ",\"frame\":\"" << frameWidth << "x" << frameHeight << "\""
+                        << ",\"module_size\":" << config.moduleSize
+                        << ",\"bits_per_module\":" << config.bitsPerModule
+                        << ",\"rs_parity\":" << config.rsParity
+                        << ",\"threads\":" << getNumThreads()
+                        << ",\"channel\":" << jsonString(channel.name)
+                        << ",\"repeat\":" << repeat
+                        << ",\"frames\":" << r.frames
+                        << ",\"frames_located\":" << r.located
+                        << ",\"frames_decoded\":" << r.decoded
+                        << ",\"bits_compared\":" << r.bitsCompared
+                        << ",\"bit_errors\":" << r.bitErrors
+                        << ",\"ber\":" << (r.bitsCompared ? (double)r.bitErrors / r.bitsCompared : 0.0)
+                        << ",\"encode_ms\":" << r.encodeSeconds * 1000 / frames
+                        << ",\"channel_ms\":" << r.channelSeconds * 1000 / frames
+                        << ",\"sample_ms\":" << r.sampleSeconds * 1000 / frames
+                        << ",\"correct_ms\":" << r.correctSeconds * 1000 / frames
+                        << ",\"encode_mbps\":" << payload.size() / max(r.encodeSeconds, 1e-9) / 1e6
+                        << ",\"decode_mbps\":" << payload.size() / max(decodeSeconds, 1e-9) / 1e6
+                        << ",\"goodput_mbps\":" << r.deliveredBytes / max(r.encodeSeconds + decodeSeconds, 1e-9) / 1e6
+                        << ",\"ok\":" << (ok ? "true" : "false")
+                        << ",\"error\":" << jsonString(r.error) << "}" << endl;
+                }
+            }
+        }
+    }
+
+    return allOk ? 0 : 1;
+}
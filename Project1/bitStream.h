@@ -0,0 +1,208 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// 按 64 位字打包的比特流，编码器与解码器共用
+// 比特 i 存放在 words[i / 64] 的第 63 - i % 64 位（高位在前，与模块写入顺序一致）
+class BitStream {
+public:
+    BitStream() : bitCount(0) {}
+    explicit BitStream(size_t bits) : bitCount(0) { resize(bits); }
+
+    // 调整长度，新增的比特为 0；额外保留一个字，便于跨字读写
+    void resize(size_t bits) {
+        words.resize((bits + 63) / 64 + 1, 0);
+        bitCount = bits;
+    }
+
+    // 调整长度并把所有比特清零；容量足够时不重新分配（供逐帧复用的缓冲区使用）
+    void assign(size_t bits) {
+        words.assign((bits + 63) / 64 + 1, 0);
+        bitCount = bits;
+    }
+
+    size_t size() const { return bitCount; }
+    bool empty() const { return bitCount == 0; }
+
+    bool get(size_t i) const {
+        return (words[i >> 6] >> (63 - (i & 63))) & 1;
+    }
+
+    bool operator[](size_t i) const { return get(i); }
+
+    void set(size_t i, bool bit) {
+        uint64_t mask = uint64_t(1) << (63 - (i & 63));
+        words[i >> 6] = bit ? (words[i >> 6] | mask) : (words[i >> 6] & ~mask);
+    }
+
+    // 在 pos 处写入 value 的低 n 位（1 <= n <= 64）
+    void writeBits(size_t pos, uint64_t value, int n) {
+        size_t w = pos >> 6;
+        int end = int(pos & 63) + n;
+        uint64_t mask = (n == 64) ? ~uint64_t(0) : ((uint64_t(1) << n) - 1);
+        value &= mask;
+        if (end <= 64) {
+            int shift = 64 - end;
+            words[w] = (words[w] & ~(mask << shift)) | (value << shift);
+        }
+        else {
+            int rest = end - 64;
+            words[w] = (words[w] & ~(mask >> rest)) | (value >> rest);
+            words[w + 1] = (words[w + 1] & (~uint64_t(0) >> rest)) | (value << (64 - rest));
+        }
+    }
+
+    // 读取 pos 处的 n 位（1 <= n <= 64）
+    uint64_t readBits(size_t pos, int n) const {
+        size_t w = pos >> 6;
+        int end = int(pos & 63) + n;
+        uint64_t mask = (n == 64) ? ~uint64_t(0) : ((uint64_t(1) << n) - 1);
+        if (end <= 64) {
+            return (words[w] >> (64 - end)) & mask;
+        }
+        int rest = end - 64;
+        return ((words[w] << rest) | (words[w + 1] >> (64 - rest))) & mask;
+    }
+
+    uint64_t* data() { return words.data(); }
+    const uint64_t* data() const { return words.data(); }
+
+private:
+    std::vector<uint64_t> words;
+    size_t bitCount;
+};
+
+// 按大端顺序把 8 个字节读成一个 64 位字
+inline uint64_t loadBigEndian64(const uint8_t* p) {
+    return (uint64_t(p[0]) << 56) | (uint64_t(p[1]) << 48) | (uint64_t(p[2]) << 40) |
+        (uint64_t(p[3]) << 32) | (uint64_t(p[4]) << 24) | (uint64_t(p[5]) << 16) |
+        (uint64_t(p[6]) << 8) | uint64_t(p[7]);
+}
+
+// 一次计算一个字中 8 个字节各自的奇偶校验，结果位于每个字节的最低位
+inline uint64_t byteParity64(uint64_t w) {
+    w ^= w >> 4;
+    w ^= w >> 2;
+    w ^= w >> 1;
+    return w & 0x0101010101010101ULL;
+}
+
+inline bool byteParity(uint8_t byte) {
+    return byteParity64(byte) & 1;
+}
+
+// 每字节编码为 9bit：8 位数据（高位在前）+ 1 位奇偶校验（1 = 奇数个 1）
+// 每 8 个字节一组，合成 72 位后整体写入
+inline void packWithParity(const uint8_t* data, size_t length, BitStream& bits) {
+    bits.assign(length * 9);
+    size_t pos = 0;
+    size_t i = 0;
+
+    for (; i + 8 <= length; i += 8, pos += 72) {
+        uint64_t parity = byteParity64(loadBigEndian64(data + i));
+        uint64_t high = 0;
+        for (int k = 0; k < 7; ++k) {
+            uint64_t group = (uint64_t(data[i + k]) << 1) | ((parity >> (56 - 8 * k)) & 1);
+            high |= group << (55 - 9 * k);
+        }
+        uint64_t last = (uint64_t(data[i + 7]) << 1) | (parity & 1);
+        bits.writeBits(pos, high | (last >> 8), 64);
+        bits.writeBits(pos + 64, last & 0xFF, 8);
+    }
+    for (; i < length; ++i, pos += 9) {
+        bits.writeBits(pos, (uint64_t(data[i]) << 1) | byteParity(data[i]), 9);
+    }
+}
+
+inline BitStream packWithParity(const std::vector<uint8_t>& data) {
+    BitStream bits;
+    packWithParity(data.data(), data.size(), bits);
+    return bits;
+}
+
+// 9 位一组还原字节，返回奇偶校验不符的字节下标
+inline std::vector<uint8_t> unpackWithParity(const BitStream& bits, std::vector<size_t>& parityErrors) {
+    size_t count = bits.size() / 9;
+    std::vector<uint8_t> bytes(count);
+    parityErrors.clear();
+
+    size_t pos = 0;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8, pos += 72) {
+        uint64_t high = bits.readBits(pos, 64);
+        uint64_t low = bits.readBits(pos + 64, 8);
+        uint64_t packed = 0;
+        uint64_t stored = 0;
+        for (int k = 0; k < 7; ++k) {
+            uint64_t group = (high >> (55 - 9 * k)) & 0x1FF;
+            packed |= (group >> 1) << (56 - 8 * k);
+            stored |= (group & 1) << (56 - 8 * k);
+        }
+        uint64_t last = ((high & 1) << 8) | low;
+        packed |= last >> 1;
+        stored |= last & 1;
+
+        for (int k = 0; k < 8; ++k) {
+            bytes[i + k] = uint8_t(packed >> (56 - 8 * k));
+        }
+
+        uint64_t mismatch = byteParity64(packed) ^ stored;
+        if (mismatch) {
+            for (int k = 0; k < 8; ++k) {
+                if ((mismatch >> (56 - 8 * k)) & 1) {
+                    parityErrors.push_back(i + k);
+                }
+            }
+        }
+    }
+    for (; i < count; ++i, pos += 9) {
+        uint64_t group = bits.readBits(pos, 9);
+        bytes[i] = uint8_t(group >> 1);
+        if (byteParity(bytes[i]) != bool(group & 1)) {
+            parityErrors.push_back(i);
+        }
+    }
+    return bytes;
+}
+
+// 每字节 8bit（高位在前），不加奇偶校验位；每 8 个字节合成一个 64 位字整体写入
+inline void packBytes(const uint8_t* data, size_t length, BitStream& bits) {
+    bits.assign(length * 8);
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        bits.writeBits(i * 8, loadBigEndian64(data + i), 64);
+    }
+    for (; i < length; ++i) {
+        bits.writeBits(i * 8, data[i], 8);
+    }
+}
+
+inline BitStream packBytes(const std::vector<uint8_t>& data) {
+    BitStream bits;
+    packBytes(data.data(), data.size(), bits);
+    return bits;
+}
+
+// 8 位一组还原字节，末尾不足 8 位的比特被丢弃
+inline void unpackBytes(const BitStream& bits, std::vector<uint8_t>& bytes) {
+    size_t count = bits.size() / 8;
+    bytes.resize(count);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint64_t word = bits.readBits(i * 8, 64);
+        for (int k = 0; k < 8; ++k) {
+            bytes[i + k] = uint8_t(word >> (56 - 8 * k));
+        }
+    }
+    for (; i < count; ++i) {
+        bytes[i] = uint8_t(bits.readBits(i * 8, 8));
+    }
+}
+
+inline std::vector<uint8_t> unpackBytes(const BitStream& bits) {
+    std::vector<uint8_t> bytes;
+    unpackBytes(bits, bytes);
+    return bytes;
+}
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// 模拟光学信道（基准测试用）：屏幕显示的帧被摄像头拍下时经历的缩放、透视、失焦、传感器噪声和有损压缩。
+// 信道写作以 '+' 连接的若干级，按书写顺序依次施加，如 "scale:0.9+blur:1.2+noise:4+jpeg:85"：
+//   noise:S        加性高斯噪声，标准差 S（灰度级）
+//   blur:S         高斯模糊，sigma = S 像素
+//   jpeg:Q         JPEG 重新压缩，质量 Q（1..100）
+//   h264:Q         整段帧序列用 H.264 重新编码（VideoWriter），Q 为编码质量（0..100，后端不支持时忽略）
+//   scale:F        按比例 F 缩放
+//   perspective:A  梯形透视：上边两端各向内收 A * 宽度，四周补白
+//   vignette:A     暗角：亮度乘以 1 - A * r^2，r 为到中心的距离（四角为 1）
+//   barrel:K       桶形镜头畸变：输出点取自半径放大 1 + K * r^2 处的原图（r 同上），四周补白
+// "none" 表示无损信道。h264 作用于整段序列，只能作为最后一级
+
+enum ChannelStageKind {
+    CHANNEL_NOISE,
+    CHANNEL_BLUR,
+    CHANNEL_JPEG,
+    CHANNEL_H264,
+    CHANNEL_SCALE,
+    CHANNEL_PERSPECTIVE,
+    CHANNEL_VIGNETTE,
+    CHANNEL_BARREL
+};
+
+struct ChannelStage {
+    ChannelStageKind kind;
+    double amount;
+};
+
+struct ChannelModel {
+    std::string name;
+    std::vector<ChannelStage> stages;
+
+    // 最后一级是否为整段序列的 H.264 重新编码
+    bool videoStage() const {
+        return !stages.empty() && stages.back().kind == CHANNEL_H264;
+    }
+};
+
+// 解析信道描述，格式错误时返回 false
+inline bool parseChannel(const std::string& spec, ChannelModel& model) {
+    model.name = spec;
+    model.stages.clear();
+    if (spec == "none") {
+        return true;
+    }
+    static const struct { const char* name; ChannelStageKind kind; } kinds[] = {
+        { "noise", CHANNEL_NOISE }, { "blur", CHANNEL_BLUR }, { "jpeg", CHANNEL_JPEG },
+        { "h264", CHANNEL_H264 }, { "scale", CHANNEL_SCALE }, { "perspective", CHANNEL_PERSPECTIVE },
+        { "vignette", CHANNEL_VIGNETTE }, { "barrel", CHANNEL_BARREL },
+    };
+    size_t start = 0;
+    while (start <= spec.size()) {
+        size_t end = spec.find('+', start);
+        if (end == std::string::npos) {
+            end = spec.size();
+        }
+        std::string item = spec.substr(start, end - start);
+        size_t colon = item.find(':');
+        if (colon == std::string::npos) {
+            return false;
+        }
+        std::string name = item.substr(0, colon);
+        char* parsed = nullptr;
+        double amount = strtod(item.c_str() + colon + 1, &parsed);
+        if (parsed == item.c_str() + colon + 1 || *parsed != '\0' || amount < 0) {
+            return false;
+        }
+
+        bool known = false;
+        for (const auto& k : kinds) {
+            if (name == k.name) {
+                model.stages.push_back({ k.kind, amount });
+                known = true;
+            }
+        }
+        if (!known || (name == "scale" && amount <= 0)) {
+            return false;
+        }
+        start = end + 1;
+    }
+    for (size_t i = 0; i + 1 < model.stages.size(); ++i) {
+        if (model.stages[i].kind == CHANNEL_H264) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 对单帧施加逐帧的各级（h264 之外），结果写入 out
+inline void applyChannel(const ChannelModel& model, const cv::Mat& in, cv::Mat& out) {
+    cv::Mat image = in;
+    for (const ChannelStage& stage : model.stages) {
+        cv::Mat next;
+        switch (stage.kind) {
+        case CHANNEL_NOISE: {
+            cv::Mat noise(image.rows, image.cols, CV_MAKETYPE(CV_16S, image.channels()));
+            cv::randn(noise, cv::Scalar::all(0), cv::Scalar::all(stage.amount));
+            cv::add(image, noise, next, cv::Mat(), image.type());
+            break;
+        }
+        case CHANNEL_BLUR:
+            if (stage.amount <= 0) {
+                continue;
+            }
+            cv::GaussianBlur(image, next, cv::Size(0, 0), stage.amount);
+            break;
+        case CHANNEL_JPEG: {
+            std::vector<uchar> encoded;
+            cv::imencode(".jpg", image, encoded, { cv::IMWRITE_JPEG_QUALITY, (int)stage.amount });
+            next = cv::imdecode(encoded, cv::IMREAD_UNCHANGED);
+            break;
+        }
+        case CHANNEL_SCALE:
+            cv::resize(image, next, cv::Size((int)(image.cols * stage.amount + 0.5), (int)(image.rows * stage.amount + 0.5)),
+                0, 0, stage.amount < 1 ? cv::INTER_AREA : cv::INTER_LINEAR);
+            break;
+        case CHANNEL_PERSPECTIVE: {
+            float w = (float)image.cols;
+            float h = (float)image.rows;
+            float inset = (float)(stage.amount * w);
+            cv::Point2f src[4] = { { 0, 0 }, { w, 0 }, { w, h }, { 0, h } };
+            cv::Point2f dst[4] = { { inset, 0 }, { w - inset, 0 }, { w, h }, { 0, h } };
+            cv::warpPerspective(image, next, cv::getPerspectiveTransform(src, dst), image.size(),
+                cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar::all(255));
+            break;
+        }
+        case CHANNEL_VIGNETTE: {
+            next.create(image.size(), image.type());
+            double cx = image.cols / 2.0, cy = image.rows / 2.0;
+            double scale = 1.0 / (cx * cx + cy * cy);
+            int channels = image.channels();
+            for (int y = 0; y < image.rows; ++y) {
+                const uint8_t* in = image.ptr<uint8_t>(y);
+                uint8_t* out = next.ptr<uint8_t>(y);
+                for (int x = 0; x < image.cols; ++x) {
+                    double dx = x + 0.5 - cx, dy = y + 0.5 - cy;
+                    double gain = std::max(0.0, 1.0 - stage.amount * (dx * dx + dy * dy) * scale);
+                    for (int c = 0; c < channels; ++c) {
+                        out[x * channels + c] = (uint8_t)(in[x * channels + c] * gain + 0.5);
+                    }
+                }
+            }
+            break;
+        }
+        case CHANNEL_BARREL: {
+            next.create(image.size(), image.type());
+            double cx = image.cols / 2.0, cy = image.rows / 2.0;
+            double scale = 1.0 / (cx * cx + cy * cy);
+            int channels = image.channels();
+            for (int y = 0; y < image.rows; ++y) {
+                uint8_t* out = next.ptr<uint8_t>(y);
+                for (int x = 0; x < image.cols; ++x) {
+                    double dx = x + 0.5 - cx, dy = y + 0.5 - cy;
+                    double factor = 1.0 + stage.amount * (dx * dx + dy * dy) * scale;
+                    double sx = cx + dx * factor - 0.5, sy = cy + dy * factor - 0.5;
+                    int x0 = (int)std::floor(sx), y0 = (int)std::floor(sy);
+                    if (x0 < 0 || y0 < 0 || x0 + 1 >= image.cols || y0 + 1 >= image.rows) {
+                        for (int c = 0; c < channels; ++c) {
+                            out[x * channels + c] = 255;
+                        }
+                        continue;
+                    }
+                    double fx = sx - x0, fy = sy - y0;
+                    const uint8_t* row0 = image.ptr<uint8_t>(y0) + x0 * channels;
+                    const uint8_t* row1 = image.ptr<uint8_t>(y0 + 1) + x0 * channels;
+                    for (int c = 0; c < channels; ++c) {
+                        double top = row0[c] + (row0[channels + c] - row0[c]) * fx;
+                        double bottom = row1[c] + (row1[channels + c] - row1[c]) * fx;
+                        out[x * channels + c] = (uint8_t)(top + (bottom - top) * fy + 0.5);
+                    }
+                }
+            }
+            break;
+        }
+        case CHANNEL_H264:
+            continue;
+        }
+        image = next;
+    }
+    out = (image.data == in.data) ? in.clone() : image;
+}
+
+// 整段序列的 H.264 重新编码：依次写入 path 再读回；后端不支持 H.264 时返回 false
+class H264Channel {
+public:
+    bool open(const std::string& path, cv::Size frameSize, bool color, double quality) {
+        file = path;
+        writer.open(path, cv::VideoWriter::fourcc('a', 'v', 'c', '1'), 30, frameSize, color);
+        if (!writer.isOpened()) {
+            return false;
+        }
+        if (quality > 0) {
+            writer.set(cv::VIDEOWRITER_PROP_QUALITY, quality);
+        }
+        return true;
+    }
+
+    void write(const cv::Mat& frame) {
+        writer.write(frame);
+    }
+
+    // 结束编码并开始读回
+    bool finish() {
+        writer.release();
+        return capture.open(file);
+    }
+
+    bool read(cv::Mat& frame) {
+        return capture.read(frame);
+    }
+
+    ~H264Channel() {
+        capture.release();
+        if (!file.empty()) {
+            std::remove(file.c_str());
+        }
+    }
+
+private:
+    std::string file;
+    cv::VideoWriter writer;
+    cv::VideoCapture capture;
+};
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bitStream.h"
+#include "reedSolomon.h"
+#include "fountain.h"
+#include "frameFormat.h"
+#include "frameDescriptor.h"
+#include "frameLocator.h"
+#include "metrics.h"
+#include "adaptiveThreshold.h"
+
+// 编解码库（qrcodec）：命令行程序 encode / decode 只负责参数解析和文件读写，逐帧编解码都在这里。
+// Encoder / Decoder 对象持有逐帧复用的工作区（模块网格、纠错码字、比特流、二值图等），
+// 实时处理时每帧直接调用，不必重新启动进程、重新解析参数或重新分配缓冲区
+
+// 流式帧编码参数
+struct EncoderConfig {
+    int frameWidth = 0;
+    int frameHeight = 0;
+    int moduleSize = MODULE_SIZE;
+    int rsParity = 32;       // 每帧交织的 RS(255, 255 - rsParity)，0 = 每字节 9bit 奇偶校验
+    int bitsPerModule = 1;   // 1 = 黑白，2 = 4 级灰度，3 = 8 色（见 modulation.h）
+    size_t chunkBytes = 0;   // 每帧数据块长度上限，0 = 网格容量（容量规划用来把数据均分到各帧）
+};
+
+// 容量规划的输入：目标显示分辨率、最小模块像素、纠错与调制参数和播放帧率
+struct PlanRequest {
+    int displayWidth = 0;
+    int displayHeight = 0;
+    int minModuleSize = MODULE_SIZE;
+    int rsParity = 32;
+    int bitsPerModule = 1;
+    int fountainOverhead = -1;   // >= 0 时按喷泉码计算帧数（k 个源符号外再加 k * P% 个冗余符号）
+    double fps = 30;
+};
+
+// 容量规划结果，config 直接交给 Encoder::configure
+struct CapacityPlan {
+    EncoderConfig config;
+    int widthCount = 0;
+    int heightCount = 0;
+    size_t capacityBytes = 0;    // 该网格每帧数据块的最大字节数（config.chunkBytes 为均分后的实际长度）
+    uint32_t frames = 0;         // 所需帧数（喷泉码含冗余帧）
+    double seconds = 0;          // 按帧率播放全部帧的时间
+    double bytesPerSecond = 0;   // 数据流吞吐量
+};
+
+// 为 streamBytes 字节的数据流选定模块大小与每帧数据块长度：帧数最少（即按帧率吞吐量最高）的方案中
+// 取模块最大的一个（同样帧数下更耐模糊和缩放），网格铺满显示分辨率；数据按所需帧数均分，
+// 末帧不再只填一小部分。最小模块下也放不下定位标记、帧描述区或帧头时返回 false
+bool planCapacity(uint64_t streamBytes, const PlanRequest& request, CapacityPlan& plan);
+
+// 流式帧编码器
+class Encoder {
+public:
+    // 按参数求出网格尺寸和每帧容量并分配工作区；分辨率放不下定位标记、帧描述区或帧头时返回 false
+    bool configure(const EncoderConfig& config);
+
+    const EncoderConfig& config() const { return cfg; }
+    int widthCount() const { return gridWidth; }
+    int heightCount() const { return gridHeight; }
+    // 每帧数据块的最大字节数（帧头之外）
+    size_t chunkBytes() const { return chunkSize; }
+    // 帧图像类型：8 色模式为 CV_8UC3，其余为 CV_8UC1
+    int frameType() const;
+
+    // 编码一帧到 image：image 按帧分辨率和 frameType() 分配，尺寸与类型已匹配时就地绘制。
+    // 顺序帧（header.fountain 为 false）的 data 为 header.length 字节数据块；
+    // 喷泉码帧的 data 为 chunkBytes() 字节编码符号
+    void encodeFrame(const FrameHeader& header, const uint8_t* data, cv::Mat& image);
+
+    // 最近一帧纠错编码后写入数据区的比特（基准测试用来统计信道误码）
+    const BitStream& frameBits() const { return bits; }
+
+private:
+    EncoderConfig cfg;
+    int gridWidth = 0;
+    int gridHeight = 0;
+    size_t chunkSize = 0;
+    FrameDescriptor descriptor;
+    std::unique_ptr<RsFrameEncoder> rs;
+    std::vector<uint8_t> frame;     // 帧头 + 数据块
+    std::vector<uint8_t> encoded;   // 交织的 RS 码字
+    BitStream bits;
+    cv::Mat moduleGrid;
+};
+
+// 单张图像编码（旧格式，黑白、每字节 9bit 奇偶校验、带帧描述区）：按 16:9 选取能容纳数据和校验码的最小网格。
+// compress 为 true 时先压缩（见 lz77.h），校验码覆盖压缩流，帧描述区带压缩标志；没有块能变短时不压缩
+void encodeSingleImage(const std::vector<uint8_t>& data, cv::Mat& image, bool compress = false);
+
+// 一帧的采样结果，由 Decoder::sample 产生、Decoder::correct 消费（视频流水线在两级之间排队传递）
+struct SampledFrame {
+    FrameDescriptor descriptor;
+    BitStream bits;
+    std::vector<uint8_t> validity;   // 每比特的不可靠程度（0 = 3x3 采样点完全一致）
+};
+
+// 同一帧多次采集的融合：发送端把每帧保持若干个刷新周期时，摄像头会拍到同一帧的多份带噪声副本。
+// 按帧描述区的帧序号归组，每个比特累加带符号的软判决 ±(255 - 有效性)（黑为正），
+// 比特取累加和的符号，有效性取 255 - |累加和|：一致的副本互相加强，不一致的互相抵消。
+// 视频中同一帧的副本是连续的，只保留当前一组，每比特一个 int16 累加和
+class FrameFusion {
+public:
+    // 把 frame 并入当前组（帧序号或数据区参数不同时先开始新的一组），
+    // frame 的比特与有效性改写为融合结果；返回组内已融合的采集次数（只有一份时结果与原采样相同）
+    int add(SampledFrame& frame);
+    void reset() { captures = 0; }
+
+private:
+    FrameDescriptor group;
+    int captures = 0;
+    std::vector<int16_t> sums;
+};
+
+// 流式帧解码器：网格、模块大小、调制与纠错参数逐帧取自帧描述区。
+// sample 与 correct 使用互不相交的工作区，可分别在流水线的两个线程中调用
+class Decoder {
+public:
+    explicit Decoder(int erasureThreshold = DEFAULT_ERASURE_THRESHOLD) : threshold(erasureThreshold) {}
+
+    // 定位帧、读取帧描述区并采样数据区；找不到帧或描述区时返回 false
+    bool sample(const cv::Mat& image, SampledFrame& frame);
+    // sample 的两步：locate 只定位并读出帧描述区（调用方可据此在采样前丢弃重复帧），
+    // sampleLocated 采样最近一次定位成功的帧（该图像须仍然有效）
+    bool locate(const cv::Mat& image, FrameDescriptor& descriptor);
+    void sampleLocated(SampledFrame& frame);
+    // 纠错并解析帧头，本帧数据块写入 chunk（复用其容量）；有无法纠正的 RS 码字时返回 false
+    bool correct(const SampledFrame& frame, FrameHeader& header, std::vector<uint8_t>& chunk);
+    // sample + correct，frame 为调用方持有的工作区
+    bool decode(const cv::Mat& image, SampledFrame& frame, FrameHeader& header, std::vector<uint8_t>& chunk);
+
+    // 单张图像解码（旧格式）：没有帧描述区时按图像尺寸推算网格，解码整个数据区并验证校验码；
+    // 帧描述区带压缩标志时校验通过后解压
+    bool decodeImage(const cv::Mat& image, std::vector<uint8_t>& data, std::vector<uint8_t>& validity);
+
+    const RsDecodeStats& stats() const { return rsStats; }
+    // 最近一帧的 RS 校验字节数
+    int rsParity() const { return lastRsParity; }
+
+private:
+    int threshold;
+    cv::Mat gray;       // sample() 的工作区
+    cv::Mat binary;
+    cv::Mat color;
+    AdaptiveBinarizer binarizer;
+    cv::Mat located;    // 最近一次定位的采样图像及其几何
+    FrameGeometry geometry;
+    std::vector<uint8_t> raw;   // correct() 的工作区
+    std::vector<uint8_t> bytes;
+    std::vector<uint8_t> ambiguity;
+    RsDecodeStats rsStats;
+    int lastRsParity = 0;
+};
+
+// 按帧序号重组数据块，收到即按位置写入输出文件，内存中不保留数据块：
+// 第 seq 帧的数据块写在 seq * 数据块长度处，其逐比特有效性写在 seq * 每帧有效性长度处，
+// 两个长度取自任一非末帧；末帧先于所有非末帧到达时暂存到长度确定为止。
+// 收到喷泉码帧时改为收集编码符号，由 FountainDecoder 恢复数据流后一次写出（译码本身需要保留全部源符号），
+// 有效性按接收顺序追加。
+// 帧描述区带压缩标志时收到的是压缩流：先原样重组到输出文件，finish() 时改名为 <输出>.lz 并逐块解压回输出文件，
+// 再验证整体校验码（有效性对应压缩流）。校验失败时恢复为收到的压缩流。
+// 给出会话文件时（断点续传，仅顺序帧）：输出文件按总帧数预分配（稀疏文件）并原地更新，
+// 每写入一个数据块就在会话文件中记下它的 CRC32 并置位已收到位图；再次以同一会话文件打开时保留已有输出，
+// 按 CRC 复核已收到的数据块后只需补收缺少的帧；续传后收到的第一帧与会话记录的传输参数不符时丢弃会话从头接收。CRC 由接收端按收到的字节计算，只能发现输出文件的改动，
+// 发现不了传输错误：奇偶校验出错的数据块照常写入但不记入会话（本次运行中仍可被后续副本替换），
+// 整体校验失败时删除会话文件，下次从头接收。全部收到并通过整体校验后同样删除会话文件
+enum AssemblyResult {
+    ASSEMBLY_VERIFIED,     // 全部收到，整体校验通过
+    ASSEMBLY_CORRUPT,      // 全部收到但整体校验失败，输出为收到的数据（供分析）
+    ASSEMBLY_INCOMPLETE    // 有缺帧；给出会话文件时进度已保存，可续传
+};
+
+class FrameAssembler {
+public:
+    bool open(const std::string& dataFile, const std::string& validityFile, const std::string& sessionFile = "");
+
+    // 是否已收到该帧（帧序号来自帧描述区，喷泉码帧为编码符号序号）；奇偶校验出错的帧不算，等待更好的副本
+    bool has(bool fountainFrame, uint32_t seq) const;
+    bool complete() const;
+
+    // 收下一帧的数据块；与之前的帧参数（含是否压缩）不一致时返回 false
+    bool add(const FrameHeader& header, const std::vector<uint8_t>& chunk, const std::vector<uint8_t>& validity);
+
+    // 结束接收：写出喷泉码恢复的数据流（压缩流先解压），回读输出文件验证整体校验码，通过后截去校验码
+    AssemblyResult finish();
+
+    // finish() 后输出文件的字节数
+    uint64_t outputBytes() const { return outputLength; }
+    // 打开时从会话文件恢复的帧数
+    uint32_t resumedFrames() const { return resumedCount; }
+    // 会话文件仍保存着接收进度（finish() 返回 ASSEMBLY_INCOMPLETE 后可用同一会话文件续传）
+    bool resumable() const { return session.is_open(); }
+    uint32_t framesReceived() const { return receivedFrames; }
+    uint32_t framesTotal() const { return totalFrames; }
+
+private:
+    void writeChunk(uint32_t seq, const std::vector<uint8_t>& chunk, const std::vector<uint8_t>& validity);
+    bool loadSession();
+    void verifySessionChunks();
+    void createSession();
+    void writeSessionHeader();
+    void recordSessionChunk(uint32_t seq, const std::vector<uint8_t>& chunk);
+    bool matchesSession(const FrameHeader& header, const std::vector<uint8_t>& chunk) const;
+    void resetProgress();
+    bool addSymbol(const FrameHeader& header, const std::vector<uint8_t>& chunk, const std::vector<uint8_t>& validity);
+    bool acceptCompression(bool compressed);
+    bool decompressOutput(const std::string& packedPath, uint64_t& length);
+    bool verifyOutput(uint64_t length);
+
+    std::string dataPath;
+    std::string validityPath;
+    std::fstream dataOut;
+    std::ofstream validityOut;
+    std::vector<bool> received;
+    std::vector<bool> parityFailed;   // 已写入但奇偶校验出错的数据块
+    uint32_t totalFrames = 0;
+    uint32_t receivedFrames = 0;
+    size_t chunkStride = 0;
+    size_t validityStride = 0;
+    size_t lastLength = 0;
+    bool lastPending = false;
+    std::vector<uint8_t> lastChunk;
+    std::vector<uint8_t> lastValidity;
+    uint64_t outputLength = 0;
+    bool streamKnown = false;        // 是否已由首帧（或会话文件）确定数据流是否压缩
+    bool compressedStream = false;
+    std::unique_ptr<FountainDecoder> fountain;
+    std::string sessionPath;
+    std::fstream session;
+    std::vector<uint8_t> sessionBitmap;   // 已写入输出文件的数据块，每帧 1 位
+    bool sessionUnconfirmed = false;      // 已从会话续传，尚未用收到的帧核对会话所属的传输
+    bool streamCrcKnown = false;          // 末帧已收到，streamCrc 为数据流末尾的整体校验码
+    uint32_t streamCrc = 0;
+    uint32_t resumedCount = 0;
+};
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CRC32_HAVE_X86 1
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CRC32_TARGET_PCLMUL
+#else
+#define CRC32_TARGET_PCLMUL __attribute__((target("pclmul,sse4.1")))
+#endif
+#endif
+
+// CRC32（IEEE 802.3，反射多项式 0xEDB88320），编码器与解码器共用
+//
+// crc32Update 为增量接口，初值为 0，可按块连续调用：
+//   crc32Update(crc32Update(0, a, n), b, m) == 整体计算 a+b 的结果
+// 运行时自动选择 PCLMULQDQ 折叠实现或 slicing-by-8 查表实现
+
+const uint32_t CRC32_POLYNOMIAL = 0xEDB88320;
+
+// 逐位计算（原始实现，保留作为基准和对照）
+inline uint32_t crc32Bitwise(uint32_t crc, const uint8_t* data, size_t length) {
+    crc = ~crc;
+    for (size_t n = 0; n < length; ++n) {
+        crc ^= data[n];
+        for (int i = 0; i < 8; i++) {
+            if (crc & 1) {
+                crc = (crc >> 1) ^ CRC32_POLYNOMIAL;
+            }
+            else {
+                crc >>= 1;
+            }
+        }
+    }
+    return ~crc;
+}
+
+// slicing-by-8 查表：table[k][b] 为字节 b 之后再经过 k 个零字节的 CRC
+struct Crc32Tables {
+    uint32_t table[8][256];
+
+    Crc32Tables() {
+        for (uint32_t b = 0; b < 256; ++b) {
+            uint32_t crc = b;
+            for (int i = 0; i < 8; i++) {
+                crc = (crc & 1) ? (crc >> 1) ^ CRC32_POLYNOMIAL : crc >> 1;
+            }
+            table[0][b] = crc;
+        }
+        for (uint32_t b = 0; b < 256; ++b) {
+            for (int k = 1; k < 8; ++k) {
+                table[k][b] = (table[k - 1][b] >> 8) ^ table[0][table[k - 1][b] & 0xFF];
+            }
+        }
+    }
+};
+
+inline const Crc32Tables& crc32Tables() {
+    static const Crc32Tables tables;
+    return tables;
+}
+
+// 查表实现，crc 为取反后的内部状态
+inline uint32_t crc32SliceBy8Raw(uint32_t crc, const uint8_t* data, size_t length) {
+    const uint32_t (*t)[256] = crc32Tables().table;
+
+    while (length >= 8) {
+        uint32_t one = crc ^ (uint32_t(data[0]) | (uint32_t(data[1]) << 8) |
+            (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24));
+        crc = t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^
+            t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24] ^
+            t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+        data += 8;
+        length -= 8;
+    }
+    while (length--) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFF];
+    }
+    return crc;
+}
+
+inline uint32_t crc32SliceBy8(uint32_t crc, const uint8_t* data, size_t length) {
+    return ~crc32SliceBy8Raw(~crc, data, length);
+}
+
+#ifdef CRC32_HAVE_X86
+// PCLMULQDQ 折叠实现（Intel “Fast CRC Computation Using PCLMULQDQ”），
+// 要求 length >= 64 且为 16 的倍数，crc 为取反后的内部状态
+CRC32_TARGET_PCLMUL
+inline uint32_t crc32PclmulRaw(uint32_t crc, const uint8_t* data, size_t length) {
+    alignas(16) static const uint64_t k1k2[2] = { 0x0154442bd4, 0x01c6e41596 };
+    alignas(16) static const uint64_t k3k4[2] = { 0x01751997d0, 0x00ccaa009e };
+    alignas(16) static const uint64_t k5k0[2] = { 0x0163cd6124, 0x0000000000 };
+    alignas(16) static const uint64_t poly[2] = { 0x01db710641, 0x01f7011641 };
+
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+    x1 = _mm_loadu_si128((const __m128i*)(data + 0x00));
+    x2 = _mm_loadu_si128((const __m128i*)(data + 0x10));
+    x3 = _mm_loadu_si128((const __m128i*)(data + 0x20));
+    x4 = _mm_loadu_si128((const __m128i*)(data + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+    x0 = _mm_load_si128((const __m128i*)k1k2);
+    data += 64;
+    length -= 64;
+
+    // 每次并行折叠 64 字节
+    while (length >= 64) {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+        y5 = _mm_loadu_si128((const __m128i*)(data + 0x00));
+        y6 = _mm_loadu_si128((const __m128i*)(data + 0x10));
+        y7 = _mm_loadu_si128((const __m128i*)(data + 0x20));
+        y8 = _mm_loadu_si128((const __m128i*)(data + 0x30));
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+        data += 64;
+        length -= 64;
+    }
+
+    // 折叠为 128 位
+    x0 = _mm_load_si128((const __m128i*)k3k4);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    // 剩余的 16 字节块
+    while (length >= 16) {
+        x2 = _mm_loadu_si128((const __m128i*)data);
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+        data += 16;
+        length -= 16;
+    }
+
+    // 128 位折叠为 64 位
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+    x0 = _mm_loadl_epi64((const __m128i*)k5k0);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett 约减到 32 位
+    x0 = _mm_load_si128((const __m128i*)poly);
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+
+// 运行时检测 CPU 是否支持 PCLMULQDQ 与 SSE4.1
+inline bool crc32CpuHasPclmul() {
+    static const bool supported = [] {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] & (1 << 1)) != 0 && (info[2] & (1 << 19)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+#endif
+    }();
+    return supported;
+}
+
+inline uint32_t crc32Pclmul(uint32_t crc, const uint8_t* data, size_t length) {
+    crc = ~crc;
+    if (length >= 64) {
+        size_t blocks = length & ~size_t(15);
+        crc = crc32PclmulRaw(crc, data, blocks);
+        data += blocks;
+        length -= blocks;
+    }
+    return ~crc32SliceBy8Raw(crc, data, length);
+}
+#endif
+
+// 增量计算接口：自动选择当前 CPU 上最快的实现
+inline uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t length) {
+#ifdef CRC32_HAVE_X86
+    if (length >= 64 && crc32CpuHasPclmul()) {
+        return crc32Pclmul(crc, data, length);
+    }
+#endif
+    return crc32SliceBy8(crc, data, length);
+}
+
+inline uint32_t crc32Update(uint32_t crc, const std::vector<uint8_t>& data) {
+    return crc32Update(crc, data.data(), data.size());
+}
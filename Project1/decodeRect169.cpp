@@ -2,17 +2,19 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
-#include <cmath>
-#include <bitset>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <atomic>
+#include <thread>
+
+#include "codec.h"
+#include "spscQueue.h"
 
 using namespace cv;
 using namespace std;
 
-// 与编码器完全相同的参数
-const int MODULE_SIZE = 10;
-const int BORDER = 4;
-const int FINDER_PATTERN_SIZE = 7;
-const int FINDER_BORDER = 1;
+// 命令行解码器：参数解析、图片序列与视频的读取流水线，逐帧解码见 codec.h / decoder.cpp
 
 // 写二进制文件
 void writeBinaryFile(const string& filename, const vector<uint8_t>& data) {
@@ -20,285 +22,318 @@ void writeBinaryFile(const string& filename, const vector<uint8_t>& data) {
     ofs.write(reinterpret_cast<const char*>(data.data()), data.size());
 }
 
-// 检测定位标记区域（与编码器完全一致）
-bool isFinderPatternArea(int x, int y, int widthCount,int heightCount) {
-    // 左上定位标记区域
-    if (x < FINDER_PATTERN_SIZE + FINDER_BORDER &&
-        y < FINDER_PATTERN_SIZE + FINDER_BORDER) {
-        return true;
-    }
-    // 右上定位标记区域
-    if (x >= widthCount - FINDER_PATTERN_SIZE - FINDER_BORDER &&
-        y < FINDER_PATTERN_SIZE + FINDER_BORDER) {
-        return true;
-    }
-    // 左下定位标记区域
-    if (x < FINDER_PATTERN_SIZE + FINDER_BORDER &&
-        y >= heightCount - FINDER_PATTERN_SIZE - FINDER_BORDER) {
-        return true;
+void printFecStats(int rsParity, const RsDecodeStats& stats) {
+    if (rsParity > 0) {
+        QRCODEC_LOG(LOG_SUMMARY, "FEC: RS(255," << 255 - rsParity << "), corrected " << stats.correctedSymbols
+            << " symbols, " << stats.erasures << " erasures, " << stats.failedBlocks << " uncorrectable blocks");
     }
-    // 对齐标记区域（如果存在）
-    if (widthCount > 15 && heightCount>15&&
-        x >= widthCount - 6 && x < widthCount - 2 &&
-        y >= heightCount - 6 && y < heightCount - 2) {
-        return true;
-    }
-
-    return false;
 }
 
-// 验证CRC32校验码（与编码器完全一致）
-bool verifyChecksum(vector<uint8_t>& data) {
-    if (data.size() < 4) {
-        cout << "Data too short for checksum verification" << endl;
-        return false;
-    }
-
-    // 提取校验码
-    uint32_t storedChecksum = (data[data.size() - 4] << 24) |
-        (data[data.size() - 3] << 16) |
-        (data[data.size() - 2] << 8) |
-        data[data.size() - 1];
-
-    // 移除校验码计算实际数据的CRC
-    vector<uint8_t> actualData(data.begin(), data.end() - 4);
-
-    // 计算CRC32（与编码器相同的算法）
-    uint32_t crc = 0xFFFFFFFF;
-    uint32_t polynomial = 0xEDB88320;
-
-    for (auto byte : actualData) {
-        crc ^= byte;
-        for (int i = 0; i < 8; i++) {
-            if (crc & 1) {
-                crc = (crc >> 1) ^ polynomial;
-            }
-            else {
-                crc >>= 1;
-            }
+// 流式解码：逐帧解码后按帧序号写入输出文件，最后统一验证整体校验码
+// 调制与纠错参数逐帧取自帧描述区；fuse 为 true 时连续的同一帧图像先融合再纠错（见 FrameFusion），
+// 已收到的帧不再纠错
+AssemblyResult decodeFrames(const vector<string>& frameFiles, int erasureThreshold, bool fuse,
+    FrameAssembler& assembler) {
+    Decoder decoder(erasureThreshold);
+    FrameFusion fusion;
+    SampledFrame sampled;
+    FrameHeader header;
+    vector<uint8_t> chunk;
+    size_t decodedFrames = 0;
+    size_t fusedFrames = 0;
+
+    auto start = chrono::steady_clock::now();
+    for (const string& file : frameFiles) {
+        Mat inputImage;
+        {
+            ScopedTimer timer(STAGE_IMREAD);
+            inputImage = imread(file, IMREAD_ANYCOLOR);
+        }
+        if (inputImage.empty()) {
+            cerr << "Cannot open image: " << file << endl;
+            continue;
+        }
+        if (!decoder.sample(inputImage, sampled)) {
+            cerr << "Failed to locate frame: " << file << endl;
+            continue;
+        }
+        if (assembler.has(sampled.descriptor.fountain(), sampled.descriptor.seq)) {
+            continue;
+        }
+        int captures = fuse ? fusion.add(sampled) : 1;
+        if (!decoder.correct(sampled, header, chunk)) {
+            cerr << "Failed to decode frame: " << file << endl;
+            continue;
+        }
+        if (captures > 1) {
+            fusedFrames++;
+            metrics().count(COUNTER_FUSED_FRAMES);
         }
-    }
-    crc = ~crc;
 
-    bool valid = (crc == storedChecksum);
-    if (valid) {
-        cout << "Checksum verification passed" << endl;
-        data = actualData; // 移除校验码，返回原始数据
-    }
-    else {
-        cout << "Checksum verification failed" << endl;
-        cout << "Expected: " << hex << storedChecksum << ", Got: " << crc << dec << endl;
+        if (!assembler.add(header, chunk, sampled.validity)) {
+            cerr << "Frame count mismatch in " << file << endl;
+            continue;
+        }
+        decodedFrames++;
     }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
 
-    return valid;
-}
+    printFecStats(decoder.rsParity(), decoder.stats());
 
-// 计算模块数量（与编码器逻辑一致）
-//int calculateModuleCount(int imageSize) {
-//    int totalModulesWithBorder = imageSize / MODULE_SIZE;
-//    int moduleCount = totalModulesWithBorder - 2 * BORDER;
-//    return moduleCount;
-//}
-int calculateWidthModuleCount(int imageWidth) {
-    return (imageWidth / MODULE_SIZE) - 2 * BORDER;
+    QRCODEC_LOG(LOG_SUMMARY, "Frames decoded: " << decodedFrames << " (" << getNumThreads() << " threads, "
+        << fusedFrames << " after fusing repeated captures)");
+    QRCODEC_LOG(LOG_SUMMARY, "Elapsed: " << seconds << " s, " << frameFiles.size() / max(seconds, 1e-9) << " frames/s");
+    return assembler.finish();
 }
 
-int calculateHeightModuleCount(int imageHeight) {
-    return (imageHeight / MODULE_SIZE) - 2 * BORDER;
-}
+// 视频解码：采集、定位采样、纠错重组三级流水线，各占一个线程，级间用有界无锁队列连接。
+// 重复帧按帧描述区的帧序号丢弃：采样级在采样前丢弃与纠错级刚解出的帧序号相同的帧（屏幕一帧被连续拍到多次），
+// 纠错级在纠错前丢弃已收到的帧；所有帧都收到后提前结束采集。
+// 纠错失败的帧不丢弃采样结果：fuse 为 true 时同一帧的后续副本与之融合后再试（见 FrameFusion）
+AssemblyResult decodeVideo(const string& videoFile, int erasureThreshold, bool fuse, FrameAssembler& assembler) {
+    VideoCapture capture(videoFile);
+    if (!capture.isOpened()) {
+        cerr << "Cannot open video: " << videoFile << endl;
+        return ASSEMBLY_INCOMPLETE;
+    }
 
-// 改进的有效性检测：使用3x3区域投票来确定每个比特的可信度
-uint8_t calculateBitValidity(const Mat& qrImage, int centerX, int centerY) {
-    int vote = 0;
-    int total = 0;
-
-    // 检查3x3区域
-    for (int i = -1; i <= 1; ++i) {
-        for (int j = -1; j <= 1; ++j) {
-            int px = centerX + i * (MODULE_SIZE / 3);
-            int py = centerY + j * (MODULE_SIZE / 3);
-
-            if (px >= 0 && px < qrImage.cols && py >= 0 && py < qrImage.rows) {
-                uchar val = qrImage.at<uchar>(py, px);
-                vote += (val < 128) ? 1 : 0; // 黑色像素计数
-                total++;
+    const size_t queueCapacity = 8;
+    SpscQueue<Mat> capturedFrames(queueCapacity);
+    SpscQueue<SampledFrame> sampledFrames(queueCapacity);
+    atomic<int64_t> lastDecodedSeq(-1);
+    size_t capturedCount = 0;
+    size_t locateFailures = 0;
+    size_t sampledDuplicates = 0;
+
+    // 定位采样与纠错分属两个线程，使用 Decoder 互不相交的两组工作区
+    Decoder decoder(erasureThreshold);
+
+    auto start = chrono::steady_clock::now();
+
+    // 第一级：采集
+    thread captureThread([&] {
+        Mat frame;
+        while (true) {
+            {
+                ScopedTimer timer(STAGE_IMREAD);
+                if (!capture.read(frame)) {
+                    break;
+                }
+            }
+            capturedCount++;
+            if (!capturedFrames.push(frame)) {
+                break;
             }
+            frame = Mat();
         }
-    }
-
-    if (total == 0) return 0;
-
-    // 计算一致性分数 (0-255)
-    double consistency = 1.0 - (2.0 * abs(vote - total / 2.0) / total);
-    uint8_t validity = static_cast<uint8_t>(consistency * 255);
-
-    return validity;
-}
-
-// 解码二维码（与编码器完全匹配）
-vector<uint8_t> decodeQRCode(const Mat& qrImage, vector<uint8_t>& validity) {
-    // 计算模块数量（与编码器相同逻辑）
-    //int imgSize = qrImage.rows;
-    //int moduleCount = calculateModuleCount(imgSize);
-    int imgWidth = qrImage.cols;
-    int imgHeight = qrImage.rows;
-
-    int widthModules = calculateWidthModuleCount(imgWidth);
-    int heightModules = calculateHeightModuleCount(imgHeight);
-
-    cout << "Module count: " << widthModules << " x " << heightModules << endl;
-
-    cout << "Image size: " << imgWidth << "x" << imgHeight<<"y" << endl;
-    cout << "Module size: " << MODULE_SIZE << endl;
-    //cout << "Module count: " << moduleCount << endl;
-
-    vector<bool> bits;
-    validity.clear();
-
-    // 按行扫描，跳过定位标记区域（与编码器写入顺序完全一致）
-    for (int y = 0; y < heightModules; ++y) {
-        for (int x = 0; x < widthModules; ++x) {
-            // 跳过定位标记区域（与编码器完全一致）
-            if (isFinderPatternArea(x, y, widthModules,heightModules)) {
+        capturedFrames.close();
+    });
+
+    // 第二级：定位与采样
+    thread sampleThread([&] {
+        Mat frame;
+        while (capturedFrames.pop(frame)) {
+            SampledFrame sampled;
+            if (!decoder.locate(frame, sampled.descriptor)) {
+                locateFailures++;
+                continue;
+            }
+            if ((int64_t)sampled.descriptor.seq == lastDecodedSeq.load()) {
+                sampledDuplicates++;
                 continue;
             }
 
-            // 读取模块中心点的值
-            int centerX = (x + BORDER) * MODULE_SIZE + MODULE_SIZE / 2;
-            int centerY = (y + BORDER) * MODULE_SIZE + MODULE_SIZE / 2;
-
-            if (centerX >= qrImage.cols) centerX = qrImage.cols - 1;
-            if (centerY >= qrImage.rows) centerY = qrImage.rows - 1;
-
-            uchar pixelValue = qrImage.at<uchar>(centerY, centerX);
-            bool bit = (pixelValue < 128); // 黑色为1，白色为0
-
-            bits.push_back(bit);
-
-            // 改进：按比特计算有效性
-            uint8_t bitValidity = calculateBitValidity(qrImage, centerX, centerY);
-            validity.push_back(bitValidity);
+            decoder.sampleLocated(sampled);
+            if (!sampledFrames.push(std::move(sampled))) {
+                break;
+            }
         }
-    }
-
-    cout << "Total bits extracted: " << bits.size() << endl;
-    cout << "Total validity bytes: " << validity.size() << endl;
-
-    // 9位一组解码（8位数据 + 1位奇偶校验）
-    vector<uint8_t> bytes;
-    for (size_t i = 0; i + 8 < bits.size(); i += 9) {
-        // 提取8位数据
-        uint8_t byte = 0;
-        for (int j = 0; j < 8; ++j) {
-            byte = (byte << 1) | (bits[i + j] ? 1 : 0);
+        capturedFrames.cancel();
+        sampledFrames.close();
+    });
+
+    // 第三级：纠错与重组（当前线程）
+    size_t decodedCount = 0;
+    size_t correctedDuplicates = 0;
+    size_t failedFrames = 0;
+    size_t fusedFrames = 0;
+    size_t payloadBytes = 0;
+    FrameFusion fusion;
+    SampledFrame sampled;
+    vector<uint8_t> chunk;
+    while (sampledFrames.pop(sampled)) {
+        const FrameDescriptor& descriptor = sampled.descriptor;
+        if (assembler.has(descriptor.fountain(), descriptor.seq)) {
+            correctedDuplicates++;
+            continue;
         }
 
-        // 检查奇偶校验位
-        bool parityBit = bits[i + 8];
-        bool calculatedParity = (bitset<8>(byte).count() % 2 == 1);
-
-        if (parityBit != calculatedParity) {
-            cout << "Parity error at byte group starting at bit " << i << endl;
-            cout << "Data: " << bitset<8>(byte) << ", Parity bit: " << parityBit
-                << ", Expected parity: " << calculatedParity << endl;
+        int captures = fuse ? fusion.add(sampled) : 1;
+        FrameHeader header;
+        if (!decoder.correct(sampled, header, chunk)) {
+            failedFrames++;
+            continue;
+        }
+        if (captures > 1) {
+            fusedFrames++;
+            metrics().count(COUNTER_FUSED_FRAMES);
         }
 
-        bytes.push_back(byte);
+        size_t chunkSize = chunk.size();
+        if (!assembler.add(header, chunk, sampled.validity)) {
+            cerr << "Frame count mismatch at frame " << header.seq << endl;
+            continue;
+        }
+        decodedCount++;
+        payloadBytes += chunkSize;
+        lastDecodedSeq.store(header.seq);
+        if (assembler.complete()) {
+            break;
+        }
     }
+    sampledFrames.cancel();
+    captureThread.join();
+    sampleThread.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    QRCODEC_LOG(LOG_SUMMARY, "Video frames: " << capturedCount << " captured, " << decodedCount << " decoded, "
+        << sampledDuplicates + correctedDuplicates << " duplicates dropped, "
+        << locateFailures << " not located, " << failedFrames << " failed, " << fusedFrames << " decoded after fusion");
+    QRCODEC_LOG(LOG_SUMMARY, "Elapsed: " << seconds << " s, " << capturedCount / max(seconds, 1e-9) << " frames/s, "
+        << payloadBytes / max(seconds, 1e-9) / 1e6 << " MB/s payload");
+    printFecStats(decoder.rsParity(), decoder.stats());
+
+    return assembler.finish();
+}
 
-    cout << "Decoded bytes (with checksum): " << bytes.size() << endl;
-
-    // 验证CRC32校验码
-    if (!bytes.empty()) {
-        bool checksumValid = verifyChecksum(bytes);
-        if (checksumValid) {
-            cout << "Data integrity verified" << endl;
+int main(int argc, char** argv) {
+    // 解析选项，其余为位置参数
+    bool streamMode = false;
+    bool videoMode = false;
+    bool fuse = true;
+    string sessionFile;
+    int threadCount = 0;
+    int erasureThreshold = DEFAULT_ERASURE_THRESHOLD;
+    string metricsFile;
+    vector<string> args;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--stream") {
+            streamMode = true;
+        }
+        else if (arg == "--video") {
+            videoMode = true;
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            threadCount = atoi(argv[++i]);
+        }
+        else if (arg == "--erasure-threshold" && i + 1 < argc) {
+            erasureThreshold = atoi(argv[++i]);
+        }
+        else if (arg == "--session" && i + 1 < argc) {
+            sessionFile = argv[++i];
+        }
+        else if (arg == "--no-fusion") {
+            fuse = false;
+        }
+        else if (arg == "--quiet") {
+            setLogLevel(LOG_QUIET);
+        }
+        else if (arg == "--verbose") {
+            setLogLevel(LOG_DETAIL);
+        }
+        else if (arg == "--metrics" && i + 1 < argc) {
+            metricsFile = argv[++i];
         }
         else {
-            cout << "Warning: Data integrity check failed" << endl;
-            // 即使校验失败，也返回数据供分析
+            args.push_back(arg);
         }
     }
 
-    return bytes;
-}
-
-// 简单的图像预处理
-Mat preprocessImage(const Mat& input) {
-    Mat processed;
-
-    // 转换为灰度图
-    if (input.channels() == 3) {
-        cvtColor(input, processed, COLOR_BGR2GRAY);
-    }
-    else {
-        processed = input.clone();
+    if ((streamMode && !videoMode ? args.size() < 3 : args.size() != 3) || (streamMode && videoMode) ||
+        (!sessionFile.empty() && !streamMode && !videoMode)) {
+        cout << "Usage: decode [--threads N] [--quiet|--verbose] [--metrics file] <input_png> <output_bin> <validity_bin>\n";
+        cout << "       decode [--threads N] --stream [--erasure-threshold T] [--no-fusion] [--session file]\n";
+        cout << "              <output_bin> <validity_bin> <frame_png>...\n";
+        cout << "       decode [--threads N] --video [--erasure-threshold T] [--no-fusion] [--session file]\n";
+        cout << "              <output_bin> <validity_bin> <video_file>\n";
+        cout << "       --session file: keep a resumable record of received chunks; rerunning with the same file\n";
+        cout << "                       on a new capture keeps the output and only fills in the missing frames\n";
+        cout << "       --no-fusion: decode repeated captures of a frame independently instead of fusing them\n";
+        cout << "       --erasure-threshold T: bytes with a bit validity >= T are RS erasures (default 113, 0 = off)\n";
+        cout << "       --quiet: print errors only; --verbose: per-frame details (builds with QRCODEC_LOG_LEVEL=2)\n";
+        cout << "       --metrics file: write per-stage timings and counters as JSON when done (- = stdout)\n";
+        cout << "       Grid size, module size, modulation and FEC are read from each frame's descriptor.\n";
+        cout << "       Exit status: 0 = verified, 1 = error or failed integrity check, 2 = incomplete with the\n";
+        cout << "       session saved (rerun with the same --session file)\n";
+        return 1;
     }
 
-    // 确保是二值图像
-    threshold(processed, processed, 128, 255, THRESH_BINARY);
-
-    return processed;
-}
-
-// 自动检测二维码区域
-bool detectQRCode(const Mat& input, Mat& outputQR) {
-    // 简单的实现：假设输入已经是正确的二维码图像
-    // 在实际应用中，这里应该添加二维码检测和定位逻辑
-
-    Mat processed = preprocessImage(input);
-
-    // 确保图像是正方形的
-    //int size = min(processed.rows, processed.cols);
-    //if (size <= 0) {
-    //    return false;
-    //}
-
-    //// 裁剪为正方形
-    //Rect roi(0, 0, size, size);
-    //outputQR = processed(roi).clone();
-    outputQR = processed.clone();
+    if (!metricsFile.empty()) {
+        metrics().enable();
+    }
 
-    // 检查图像大小是否合理
-    if (outputQR.rows % MODULE_SIZE != 0) {
-        cout << "Warning: Image size may not match module size" << endl;
+    // 采样线程数，0 表示使用 OpenCV 默认值（全部核心）
+    if (threadCount > 0) {
+        setNumThreads(threadCount);
     }
 
-    return true;
-}
+    if (streamMode || videoMode) {
+        // 数据块边解码边写入输出文件
+        FrameAssembler assembler;
+        if (!assembler.open(args[0], args[1], sessionFile)) {
+            cerr << "Cannot open output files: " << args[0] << ", " << args[1] << endl;
+            return 1;
+        }
+        vector<string> frameFiles(args.begin() + 2, args.end());
+        AssemblyResult result = videoMode
+            ? decodeVideo(args[2], erasureThreshold, fuse, assembler)
+            : decodeFrames(frameFiles, erasureThreshold, fuse, assembler);
+        if (!metricsFile.empty() && !writeMetricsFile(metricsFile, "decode")) {
+            cerr << "Cannot write metrics: " << metricsFile << endl;
+        }
+        if (result == ASSEMBLY_INCOMPLETE) {
+            // 续传进度已保存时不算出错，只是还没收完
+            if (assembler.resumable()) {
+                cerr << "Incomplete: " << assembler.framesReceived() << " of " << assembler.framesTotal()
+                    << " frames received, session saved to " << sessionFile
+                    << "; rerun with it to receive the missing frames" << endl;
+                return 2;
+            }
+            cerr << "Error: No data decoded!" << endl;
+            return 1;
+        }
 
-int main(int argc, char** argv) {
-    if (argc != 4) {
-        cout << "Usage: decode <input_png> <output_bin> <validity_bin>\n";
-        return 1;
+        QRCODEC_LOG(LOG_SUMMARY, "Output files: " << args[0] << ", " << args[1]);
+        QRCODEC_LOG(LOG_SUMMARY, "Decoded data size: " << assembler.outputBytes() << " bytes");
+        return result == ASSEMBLY_VERIFIED ? 0 : 1;
     }
 
-    string inputFile = argv[1];
-    string outputFile = argv[2];
-    string validityFile = argv[3];
+    string inputFile = args[0];
+    string outputFile = args[1];
+    string validityFile = args[2];
 
     // 读取输入图像
-    Mat inputImage = imread(inputFile, IMREAD_GRAYSCALE);
+    Mat inputImage;
+    {
+        ScopedTimer timer(STAGE_IMREAD);
+        inputImage = imread(inputFile, IMREAD_GRAYSCALE);
+    }
     if (inputImage.empty()) {
         cerr << "Cannot open image: " << inputFile << endl;
         return 1;
     }
 
-    cout << "Input image size: " << inputImage.cols << "x" << inputImage.rows << endl;
-
-    // 检测并提取二维码
-    Mat qrImage;
-    if (!detectQRCode(inputImage, qrImage)) {
-        cerr << "Failed to process QR code image" << endl;
-        return 1;
-    }
-
-    cout << "QR image size: " << qrImage.rows << "x" << qrImage.cols << endl;
+    QRCODEC_LOG(LOG_SUMMARY, "Input image size: " << inputImage.cols << "x" << inputImage.rows);
 
+    Decoder decoder;
     vector<uint8_t> validity;
-    vector<uint8_t> decodedData = decodeQRCode(qrImage, validity);
-
-    if (decodedData.empty()) {
+    vector<uint8_t> decodedData;
+    bool decoded = decoder.decodeImage(inputImage, decodedData, validity);
+    if (!metricsFile.empty() && !writeMetricsFile(metricsFile, "decode")) {
+        cerr << "Cannot write metrics: " << metricsFile << endl;
+    }
+    if (!decoded) {
         cerr << "Error: No data decoded!" << endl;
         return 1;
     }
@@ -306,9 +341,9 @@ int main(int argc, char** argv) {
     writeBinaryFile(outputFile, decodedData);
     writeBinaryFile(validityFile, validity);
 
-    cout << "Decoding completed successfully!" << endl;
-    cout << "Output files: " << outputFile << ", " << validityFile << endl;
-    cout << "Decoded data size: " << decodedData.size() << " bytes" << endl;
+    QRCODEC_LOG(LOG_SUMMARY, "Decoding completed successfully!");
+    QRCODEC_LOG(LOG_SUMMARY, "Output files: " << outputFile << ", " << validityFile);
+    QRCODEC_LOG(LOG_SUMMARY, "Decoded data size: " << decodedData.size() << " bytes");
 
     return 0;
-}
\ No newline at end of file
+}
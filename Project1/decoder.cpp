@@ -0,0 +1,1161 @@
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <bitset>
+#include <algorithm>
+#include <filesystem>
+
+#include "codec.h"
+#include "crc32.h"
+#include "frameLayout.h"
+#include "sampleKernel.h"
+#include "modulation.h"
+#include "frameLocator.h"
+#include "adaptiveThreshold.h"
+#include "lz77.h"
+
+using namespace cv;
+using namespace std;
+
+// 解码器实现：定位、采样、纠错，以及 Decoder 和 FrameAssembler
+
+// 3x3 采样点的间距（以模块为单位，与像素采样的 MODULE_SIZE / 3 一致）
+const double SAMPLE_OFFSET = double(MODULE_SIZE / 3) / MODULE_SIZE;
+
+// 输出校验码比较结果
+bool reportChecksum(uint32_t storedChecksum, uint32_t crc) {
+    bool valid = (crc == storedChecksum);
+    if (valid) {
+        QRCODEC_LOG(LOG_SUMMARY, "Checksum verification passed");
+    }
+    else {
+        QRCODEC_LOG(LOG_SUMMARY, "Checksum verification failed");
+        QRCODEC_LOG(LOG_SUMMARY, "Expected: " << hex << storedChecksum << ", Got: " << crc << dec);
+    }
+    return valid;
+}
+
+// 验证CRC32校验码（与编码器完全一致）
+bool verifyChecksum(vector<uint8_t>& data) {
+    ScopedTimer timer(STAGE_VERIFY);
+    if (data.size() < 4) {
+        QRCODEC_LOG(LOG_SUMMARY, "Data too short for checksum verification");
+        return false;
+    }
+
+    // 提取校验码
+    uint32_t storedChecksum = (data[data.size() - 4] << 24) |
+        (data[data.size() - 3] << 16) |
+        (data[data.size() - 2] << 8) |
+        data[data.size() - 1];
+
+    // 计算实际数据（不含校验码）的CRC32（与编码器共用 crc32.h）
+    uint32_t crc;
+    {
+        ScopedTimer crcTimer(STAGE_CRC);
+        crc = crc32Update(0, data.data(), data.size() - 4);
+    }
+
+    bool valid = reportChecksum(storedChecksum, crc);
+    if (valid) {
+        data.resize(data.size() - 4); // 移除校验码，返回原始数据
+    }
+
+    return valid;
+}
+
+// 计算模块数量（与编码器逻辑一致）
+//int calculateModuleCount(int imageSize) {
+//    int totalModulesWithBorder = imageSize / MODULE_SIZE;
+//    int moduleCount = totalModulesWithBorder - 2 * BORDER;
+//    return moduleCount;
+//}
+int calculateWidthModuleCount(int imageWidth) {
+    return (imageWidth / MODULE_SIZE) - 2 * BORDER;
+}
+
+int calculateHeightModuleCount(int imageHeight) {
+    return (imageHeight / MODULE_SIZE) - 2 * BORDER;
+}
+
+// 改进的有效性检测：使用3x3区域投票来确定每个比特的可信度
+// （逐点检查边界的通用版本，仅用于采样点越界的模块；常规模块走 sampleKernel.h 的向量化路径）
+uint8_t calculateBitValidity(const Mat& qrImage, int centerX, int centerY) {
+    int vote = 0;
+    int total = 0;
+
+    // 检查3x3区域
+    for (int i = -1; i <= 1; ++i) {
+        for (int j = -1; j <= 1; ++j) {
+            int px = centerX + i * (MODULE_SIZE / 3);
+            int py = centerY + j * (MODULE_SIZE / 3);
+
+            if (px >= 0 && px < qrImage.cols && py >= 0 && py < qrImage.rows) {
+                uchar val = qrImage.at<uchar>(py, px);
+                vote += (val < 128) ? 1 : 0; // 黑色像素计数
+                total++;
+            }
+        }
+    }
+
+    // 计算一致性分数 (0-255)
+    return validityFromVotes(vote, total);
+}
+
+// 简单的图像预处理
+// 多电平调制（bitsPerModule > 1）时不做二值化，8 色模式保留三通道
+Mat preprocessImage(const Mat& input, int bitsPerModule = 1) {
+    Mat processed;
+
+    if (modulationChannels(bitsPerModule) == 3) {
+        if (input.channels() == 3) {
+            return input.clone();
+        }
+        cvtColor(input, processed, COLOR_GRAY2BGR);
+        return processed;
+    }
+
+    // 转换为灰度图
+    if (input.channels() == 3) {
+        cvtColor(input, processed, COLOR_BGR2GRAY);
+    }
+    else {
+        processed = input.clone();
+    }
+
+    // 确保是二值图像（局部自适应阈值，见 adaptiveThreshold.h）
+    if (bitsPerModule == 1) {
+        Mat binary;
+        AdaptiveBinarizer().apply(processed, binary);
+        processed = binary;
+    }
+
+    return processed;
+}
+
+// 编码器原样输出的帧几何（网格尺寸由图像尺寸推算）
+FrameGeometry nominalGeometry(const Mat& image) {
+    return nominalFrameGeometry(calculateWidthModuleCount(image.cols),
+        calculateHeightModuleCount(image.rows), MODULE_SIZE, BORDER);
+}
+
+// 自动检测二维码区域：按定位标记和对齐标记求出模块网格到像素的几何关系（见 frameLocator.h），
+// 与编码器原样输出相差不到一个像素时按标准几何采样；找不到定位标记时假设输入未经缩放
+bool detectQRCode(const Mat& input, Mat& outputQR, FrameGeometry& geometry, int bitsPerModule = 1) {
+    outputQR = preprocessImage(input, bitsPerModule);
+
+    // 多电平帧的定位标记仍为黑白，先二值化再定位
+    Mat binary = outputQR;
+    if (bitsPerModule > 1) {
+        Mat gray = outputQR;
+        if (gray.channels() == 3) {
+            cvtColor(outputQR, gray, COLOR_BGR2GRAY);
+        }
+        binary = Mat();
+        AdaptiveBinarizer().apply(gray, binary);
+    }
+
+    FrameGeometry nominal = nominalGeometry(outputQR);
+    if (!locateFrame(binary, geometry)) {
+        QRCODEC_LOG(LOG_SUMMARY, "Warning: Finder patterns not found, assuming an unscaled frame");
+        geometry = nominal;
+        if (outputQR.rows % MODULE_SIZE != 0) {
+            QRCODEC_LOG(LOG_SUMMARY, "Warning: Image size may not match module size");
+        }
+    }
+    else if (geometryClose(geometry, nominal, 1.0)) {
+        geometry = nominal;
+    }
+
+    return geometry.widthCount > 0 && geometry.heightCount > 0;
+}
+
+// 模块中心像素坐标（标准几何，越界时截断到图像边缘）
+inline void moduleCenter(const Mat& qrImage, const ModuleCoord& m, int& centerX, int& centerY) {
+    centerX = min((m.x + BORDER) * MODULE_SIZE + MODULE_SIZE / 2, qrImage.cols - 1);
+    centerY = min((m.y + BORDER) * MODULE_SIZE + MODULE_SIZE / 2, qrImage.rows - 1);
+}
+
+// 模块中心的网格坐标（非标准几何）：有定时线修正时叠加逐行、逐列偏移
+inline void moduleGridCenter(const FrameGeometry& geometry, const ModuleCoord& m, double& mx, double& my) {
+    mx = m.x + 0.5;
+    my = m.y + 0.5;
+    if (!geometry.timing.empty()) {
+        double dx, dy;
+        geometry.timing.shift(m.x, m.y, dx, dy);
+        mx += dx;
+        my += dy;
+    }
+}
+
+// 网格坐标 (mx, my) 处第 (i, j) 个 3x3 采样点的像素坐标，可能越界
+inline void gridSamplePoint(const FrameGeometry& geometry, double mx, double my, int i, int j, int& px, int& py) {
+    double x, y;
+    geometry.project(mx + i * SAMPLE_OFFSET, my + j * SAMPLE_OFFSET, x, y);
+    px = (int)floor(x);
+    py = (int)floor(y);
+}
+
+// 模块内第 (i, j) 个 3x3 采样点（i, j 取 -1..1）的像素坐标，可能越界
+inline void moduleSamplePoint(const FrameGeometry& geometry, const ModuleCoord& m, int i, int j,
+    int& px, int& py) {
+    if (geometry.nominal) {
+        px = (m.x + BORDER) * MODULE_SIZE + MODULE_SIZE / 2 + i * (MODULE_SIZE / 3);
+        py = (m.y + BORDER) * MODULE_SIZE + MODULE_SIZE / 2 + j * (MODULE_SIZE / 3);
+        return;
+    }
+    double mx, my;
+    moduleGridCenter(geometry, m, mx, my);
+    gridSamplePoint(geometry, mx, my, i, j, px, py);
+}
+
+// 读取帧描述区：每个模块做 3x3 投票取多数，按列组成字节后纠错解析
+bool readFrameDescriptor(const Mat& binary, const FrameGeometry& geometry, FrameDescriptor& descriptor) {
+    if (geometry.widthCount < DESCRIPTOR_MIN_WIDTH) {
+        return false;
+    }
+    vector<uint8_t> bytes(DESCRIPTOR_COLUMNS, 0);
+    for (int i = 0; i < DESCRIPTOR_COLUMNS; ++i) {
+        for (int bit = 0; bit < DESCRIPTOR_ROWS; ++bit) {
+            ModuleCoord m = descriptorModule(i, bit);
+            int vote = 0;
+            int total = 0;
+            for (int j = -1; j <= 1; ++j) {
+                for (int k = -1; k <= 1; ++k) {
+                    int px, py;
+                    moduleSamplePoint(geometry, m, k, j, px, py);
+                    if (px >= 0 && px < binary.cols && py >= 0 && py < binary.rows) {
+                        vote += binary.ptr<uint8_t>(py)[px] < 128;
+                        total++;
+                    }
+                }
+            }
+            bytes[i] = (uint8_t)((bytes[i] << 1) | (vote * 2 > total));
+        }
+    }
+    return decodeFrameDescriptor(bytes, descriptor);
+}
+
+// 帧描述区给出的参数是否可用（网格与数据区都放得下）。描述区只有纠错没有认证，字段须先限定范围再使用：
+// 网格须放得进图像（每模块至少 1 像素），located 时还须与定位估计的网格相差不到一倍，
+// 否则伪造的网格尺寸会让 getFrameLayout 建出（并永久缓存）巨大的布局；RS 校验字节数同编码器的 0..254
+bool descriptorValid(const FrameDescriptor& descriptor, const Mat& image, const FrameGeometry& geometry, bool located) {
+    if (descriptor.widthCount < DESCRIPTOR_MIN_WIDTH ||
+        descriptor.heightCount < 2 * (FINDER_PATTERN_SIZE + FINDER_BORDER) ||
+        descriptor.moduleSize < 3 || descriptor.bitsPerModule < 1 || descriptor.bitsPerModule > MAX_BITS_PER_MODULE ||
+        descriptor.rsParity >= RS_BLOCK_SIZE || descriptor.payloadBytes <= FRAME_HEADER_SIZE) {
+        return false;
+    }
+    if (descriptor.widthCount > image.cols || descriptor.heightCount > image.rows) {
+        return false;
+    }
+    if (located && (descriptor.widthCount > 2 * geometry.widthCount || 2 * descriptor.widthCount < geometry.widthCount ||
+        descriptor.heightCount > 2 * geometry.heightCount || 2 * descriptor.heightCount < geometry.heightCount)) {
+        return false;
+    }
+    const FrameLayout& layout = getFrameLayout(descriptor.widthCount, descriptor.heightCount,
+        calibrationLevels(descriptor.bitsPerModule), true, descriptor.timing());
+    return descriptorPayloadBits(descriptor) <= layout.dataModuleCount() * descriptor.bitsPerModule;
+}
+
+// 检测流式帧：定位后读取帧描述区，网格尺寸以描述区为准（与定位估计不同时按新尺寸重新求单应变换），
+// 再按描述区的调制方式准备采样图像（黑白为二值图，4 级灰度为灰度图，8 色为三通道图）
+// 二值图用局部自适应阈值（见 adaptiveThreshold.h），暗角、亮度不均时定位和采样都以它为准
+// gray、binary、color、binarizer 为逐帧复用的工作区，outputQR 可能指向其中之一或 input
+bool detectFrame(const Mat& input, Mat& outputQR, FrameGeometry& geometry, FrameDescriptor& descriptor,
+    Mat& gray, Mat& binary, Mat& color, AdaptiveBinarizer& binarizer) {
+    // 工作区不能与 input 共享数据，否则下一帧会写坏调用方的图像
+    const Mat* grayImage = &input;
+    if (input.channels() == 3) {
+        cvtColor(input, gray, COLOR_BGR2GRAY);
+        grayImage = &gray;
+    }
+    binarizer.apply(*grayImage, binary);
+
+    bool located = locateFrame(binary, geometry);
+    if (!located) {
+        QRCODEC_LOG(LOG_DETAIL, "Warning: Finder patterns not found, assuming an unscaled frame");
+        geometry = nominalGeometry(binary);
+    }
+    if (!readFrameDescriptor(binary, geometry, descriptor) || !descriptorValid(descriptor, binary, geometry, located)) {
+        QRCODEC_LOG(LOG_DETAIL, "Frame descriptor not found");
+        return false;
+    }
+
+    if (descriptor.widthCount != geometry.widthCount || descriptor.heightCount != geometry.heightCount) {
+        geometry = resizeFrameGeometry(geometry, descriptor.widthCount, descriptor.heightCount);
+    }
+    if (descriptor.moduleSize == MODULE_SIZE) {
+        FrameGeometry nominal = nominalFrameGeometry(descriptor.widthCount, descriptor.heightCount, MODULE_SIZE, BORDER);
+        if (geometryClose(geometry, nominal, 1.0)) {
+            geometry = nominal;
+        }
+    }
+    // 宽网格带定时线：沿定时线测出逐行、逐列的亚像素偏移，修正镜头畸变等单应变换拟合不了的形变
+    if (descriptor.timing() && !geometry.nominal) {
+        fitTimingPatterns(*grayImage, getFrameLayout(descriptor.widthCount, descriptor.heightCount,
+            calibrationLevels(descriptor.bitsPerModule), true, true), geometry);
+    }
+
+    if (descriptor.bitsPerModule == 1) {
+        outputQR = binary;
+    }
+    else if (modulationChannels(descriptor.bitsPerModule) == 1) {
+        outputQR = *grayImage;
+    }
+    else if (input.channels() == 3) {
+        outputQR = input;
+    }
+    else {
+        cvtColor(input, color, COLOR_GRAY2BGR);
+        outputQR = color;
+    }
+    return true;
+}
+
+// 采样 [begin, end) 范围内的数据模块：每个模块行先用 columnVotes 一次算出三行的列投票，
+// 再逐模块查表得到比特和有效性；采样点越界的模块退回逐点检查的通用版本
+void sampleModuleRange(const Mat& qrImage, const FrameLayout& layout, size_t begin, size_t end,
+    BitStream& bits, vector<uint8_t>& validity) {
+    const int offset = MODULE_SIZE / 3;
+    const ValidityTable& table = validityTable();
+    vector<uint8_t> votes(qrImage.cols);
+    int votesRow = -1;
+    bool rowInside = false;
+
+    for (size_t i = begin; i < end; ++i) {
+        int centerX, centerY;
+        moduleCenter(qrImage, layout.dataModules[i], centerX, centerY);
+
+        if (centerY != votesRow) {
+            votesRow = centerY;
+            rowInside = (centerY - offset >= 0 && centerY + offset < qrImage.rows);
+            if (rowInside) {
+                columnVotes(qrImage.ptr<uint8_t>(centerY - offset), qrImage.ptr<uint8_t>(centerY),
+                    qrImage.ptr<uint8_t>(centerY + offset), qrImage.cols, votes.data());
+            }
+        }
+
+        if (rowInside && centerX - offset >= 0 && centerX + offset < qrImage.cols) {
+            bits.set(i, sampleFromVotes(votes.data(), qrImage.ptr<uint8_t>(centerY), centerX,
+                offset, table, validity[i]));
+        }
+        else {
+            bits.set(i, qrImage.at<uchar>(centerY, centerX) < 128); // 黑色为1，白色为0
+            validity[i] = calculateBitValidity(qrImage, centerX, centerY);
+        }
+    }
+}
+
+// 模块内 3x3 采样点（越界时截断到图像边缘）的逐通道均值
+inline void moduleMean(const Mat& qrImage, const FrameGeometry& geometry, const ModuleCoord& m, uint8_t* mean) {
+    int channels = qrImage.channels();
+    int sum[3] = { 0, 0, 0 };
+    for (int j = -1; j <= 1; ++j) {
+        for (int i = -1; i <= 1; ++i) {
+            int px, py;
+            moduleSamplePoint(geometry, m, i, j, px, py);
+            px = min(max(px, 0), qrImage.cols - 1);
+            py = min(max(py, 0), qrImage.rows - 1);
+            const uint8_t* pixel = qrImage.ptr<uint8_t>(py) + px * channels;
+            for (int c = 0; c < channels; ++c) {
+                sum[c] += pixel[c];
+            }
+        }
+    }
+    for (int c = 0; c < channels; ++c) {
+        mean[c] = (uint8_t)((sum[c] + 4) / 9);
+    }
+}
+
+// 由帧内校准色块测得各电平的中心（每个电平 CALIBRATION_REPEAT 个模块取平均）
+LevelCalibration calibrateLevels(const Mat& qrImage, const FrameGeometry& geometry, const FrameLayout& layout,
+    int bitsPerModule) {
+    LevelCalibration calibration;
+    calibration.levels = calibrationLevels(bitsPerModule);
+    calibration.channels = qrImage.channels();
+    for (int level = 0; level < calibration.levels; ++level) {
+        for (int k = 0; k < CALIBRATION_REPEAT; ++k) {
+            uint8_t mean[3];
+            moduleMean(qrImage, geometry, layout.calibrationModules[level * CALIBRATION_REPEAT + k], mean);
+            for (int c = 0; c < calibration.channels; ++c) {
+                calibration.centers[level][c] += mean[c] / (float)CALIBRATION_REPEAT;
+            }
+        }
+    }
+    return calibration;
+}
+
+// 多电平采样 [begin, end) 范围内的数据模块：每个模块按 3x3 均值分类为符号，写出 bitsPerModule 个比特，
+// 这些比特的有效性均取分类的不可靠程度
+void sampleSymbolRange(const Mat& qrImage, const FrameGeometry& geometry, const FrameLayout& layout,
+    const LevelCalibration& calibration, int bitsPerModule, size_t begin, size_t end,
+    BitStream& bits, vector<uint8_t>& validity) {
+    for (size_t i = begin; i < end; ++i) {
+        uint8_t mean[3];
+        uint8_t ambiguity;
+        moduleMean(qrImage, geometry, layout.dataModules[i], mean);
+        int symbol = calibration.classify(mean, ambiguity);
+
+        size_t pos = i * bitsPerModule;
+        bits.writeBits(pos, symbol, bitsPerModule);
+        fill(validity.begin() + pos, validity.begin() + pos + bitsPerModule, ambiguity);
+    }
+}
+
+// 透视、缩放帧的采样：逐模块把 3x3 采样点投影到像素坐标后投票，越界的采样点不计入；
+// 有定时线修正时模块中心先按逐行、逐列偏移移动（每模块查一次表）
+void sampleWarpedRange(const Mat& qrImage, const FrameGeometry& geometry, const FrameLayout& layout,
+    size_t begin, size_t end, BitStream& bits, vector<uint8_t>& validity) {
+    const ValidityTable& table = validityTable();
+    for (size_t i = begin; i < end; ++i) {
+        double mx, my;
+        moduleGridCenter(geometry, layout.dataModules[i], mx, my);
+        int vote = 0;
+        int total = 0;
+        bool bit = false;
+        for (int j = -1; j <= 1; ++j) {
+            for (int k = -1; k <= 1; ++k) {
+                int px, py;
+                gridSamplePoint(geometry, mx, my, k, j, px, py);
+                if (px >= 0 && px < qrImage.cols && py >= 0 && py < qrImage.rows) {
+                    bool dark = qrImage.ptr<uint8_t>(py)[px] < 128;
+                    vote += dark;
+                    total++;
+                    if (j == 0 && k == 0) {
+                        bit = dark; // 黑色为1，白色为0
+                    }
+                }
+            }
+        }
+        bits.set(i, bit);
+        validity[i] = (total == 9) ? table.value[vote] : validityFromVotes(vote, total);
+    }
+}
+
+// 按布局顺序采样所有数据模块（与编码器写入顺序完全一致，定位标记区域已排除）
+// 模块网格按水平条带划分后并行处理；条带边界取该行首个数据模块下标并向下对齐到 64，
+// 各条带写入互不重叠的 BitStream 字和有效性区间，结果与串行扫描完全一致
+// bitsPerModule > 1 时先由校准色块确定各电平中心，每模块输出 bitsPerModule 个比特；
+// 非标准几何（缩放、旋转、透视）时逐模块投影采样点
+// descriptor 不为空时布局让出帧描述区，且只采样到其给出的数据区末尾
+void sampleDataBits(const Mat& qrImage, const FrameGeometry& geometry, BitStream& bits,
+    vector<uint8_t>& validity, int bitsPerModule = 1, const FrameDescriptor* descriptor = nullptr) {
+    int heightModules = geometry.heightCount;
+    const FrameLayout& layout = getFrameLayout(geometry.widthCount, heightModules, calibrationLevels(bitsPerModule),
+        descriptor != nullptr, descriptor && descriptor->timing());
+    size_t count = layout.dataModuleCount();
+    if (descriptor) {
+        count = min(count, (descriptorPayloadBits(*descriptor) + bitsPerModule - 1) / bitsPerModule);
+    }
+    bits.assign(count * bitsPerModule);
+    validity.resize(count * bitsPerModule);
+
+    LevelCalibration calibration;
+    if (bitsPerModule > 1) {
+        calibration = calibrateLevels(qrImage, geometry, layout, bitsPerModule);
+    }
+    auto sampleRange = [&](size_t begin, size_t end) {
+        if (bitsPerModule > 1) {
+            sampleSymbolRange(qrImage, geometry, layout, calibration, bitsPerModule, begin, end, bits, validity);
+        }
+        else if (geometry.nominal) {
+            sampleModuleRange(qrImage, layout, begin, end, bits, validity);
+        }
+        else {
+            sampleWarpedRange(qrImage, geometry, layout, begin, end, bits, validity);
+        }
+    };
+
+    // 只在含有待采样模块的行上划分条带
+    int usedRows = heightModules;
+    while (usedRows > 0 && layout.rowStart[usedRows - 1] >= count) {
+        usedRows--;
+    }
+    int bandCount = min(usedRows, getNumThreads() * 4);
+    if (bandCount <= 1 || count < 64) {
+        sampleRange(0, count);
+        return;
+    }
+
+    auto bandBoundary = [&](int band) -> size_t {
+        if (band >= bandCount) {
+            return count;
+        }
+        return min(count, layout.rowStart[(size_t)usedRows * band / bandCount] & ~size_t(63));
+    };
+
+    parallel_for_(Range(0, bandCount), [&](const Range& range) {
+        for (int band = range.start; band < range.end; ++band) {
+            sampleRange(bandBoundary(band), bandBoundary(band + 1));
+        }
+    });
+}
+
+// 9位一组解码（8位数据 + 1位奇偶校验）
+// 奇偶校验不符的字节只计数，其下标（升序）写入 errors（可为空）；逐字节明细仅在 LOG_DETAIL 构建中输出
+vector<uint8_t> bitsToBytes(const BitStream& bits, vector<size_t>* errors = nullptr) {
+    ScopedTimer timer(STAGE_FEC);
+    vector<size_t> localErrors;
+    vector<size_t>& parityErrors = errors ? *errors : localErrors;
+    vector<uint8_t> bytes = unpackWithParity(bits, parityErrors);
+    metrics().count(COUNTER_PARITY_ERRORS, parityErrors.size());
+
+    for (size_t i : parityErrors) {
+        QRCODEC_LOG(LOG_DETAIL, "Parity error at byte group starting at bit " << i * 9 << ", data: "
+            << bitset<8>(bytes[i]) << ", parity bit: " << bits[i * 9 + 8]
+            << ", expected parity: " << byteParity(bytes[i]));
+    }
+    return bytes;
+}
+
+// 统计有效性不低于阈值的模块（每模块 bitsPerModule 个比特共用同一有效性）
+void countLowValidity(const vector<uint8_t>& validity, int bitsPerModule, int threshold) {
+    if (!metrics().enabled()) {
+        return;
+    }
+    uint8_t limit = (uint8_t)(threshold > 0 ? threshold : DEFAULT_ERASURE_THRESHOLD);
+    size_t low = count_if(validity.begin(), validity.end(), [limit](uint8_t v) { return v >= limit; });
+    metrics().count(COUNTER_LOW_VALIDITY, low / bitsPerModule);
+}
+
+// 解码二维码（与编码器完全匹配）
+// descriptor 不为空时只解码到帧描述区给出的数据末尾；为空时按旧格式解码整个数据区
+// checksumValid 不为空时写入校验结果
+vector<uint8_t> decodeQRCode(const Mat& qrImage, const FrameGeometry& geometry, vector<uint8_t>& validity,
+    const FrameDescriptor* descriptor = nullptr, bool* checksumValid = nullptr) {
+    // 模块数量由定位结果给出（未缩放的帧与编码器逻辑相同）
+    //int imgSize = qrImage.rows;
+    //int moduleCount = calculateModuleCount(imgSize);
+    int imgWidth = qrImage.cols;
+    int imgHeight = qrImage.rows;
+
+    QRCODEC_LOG(LOG_SUMMARY, "Module count: " << geometry.widthCount << " x " << geometry.heightCount
+        << (geometry.nominal ? "" : " (rectified)"));
+
+    QRCODEC_LOG(LOG_SUMMARY, "Image size: " << imgWidth << "x" << imgHeight << "y");
+    QRCODEC_LOG(LOG_SUMMARY, "Module size: " << MODULE_SIZE);
+    //cout << "Module count: " << moduleCount << endl;
+
+    BitStream bits;
+    {
+        ScopedTimer timer(STAGE_SAMPLE);
+        sampleDataBits(qrImage, geometry, bits, validity, 1, descriptor);
+    }
+    countLowValidity(validity, 1, DEFAULT_ERASURE_THRESHOLD);
+
+    QRCODEC_LOG(LOG_SUMMARY, "Total bits extracted: " << bits.size());
+    QRCODEC_LOG(LOG_SUMMARY, "Total validity bytes: " << validity.size());
+
+    vector<uint8_t> bytes = bitsToBytes(bits);
+    if (descriptor) {
+        bytes.resize(descriptor->payloadBytes);
+    }
+
+    QRCODEC_LOG(LOG_SUMMARY, "Decoded bytes (with checksum): " << bytes.size());
+
+    // 验证CRC32校验码
+    bool valid = false;
+    if (!bytes.empty()) {
+        valid = verifyChecksum(bytes);
+        if (valid) {
+            QRCODEC_LOG(LOG_SUMMARY, "Data integrity verified");
+        }
+        else {
+            QRCODEC_LOG(LOG_SUMMARY, "Warning: Data integrity check failed");
+            // 即使校验失败，也返回数据供分析
+        }
+    }
+    if (checksumValid) {
+        *checksumValid = valid;
+    }
+
+    return bytes;
+}
+
+// 每个字节的不可靠程度：比特有效性为 3x3 投票的不一致程度（0 = 九点一致，越大越不可靠），
+// 取组成该字节的 8 个比特中的最大值
+void byteAmbiguity(const vector<uint8_t>& validity, size_t byteCount, vector<uint8_t>& ambiguity) {
+    ambiguity.resize(byteCount);
+    for (size_t i = 0; i < byteCount; ++i) {
+        ambiguity[i] = *max_element(validity.begin() + i * 8, validity.begin() + i * 8 + 8);
+    }
+}
+
+// 数据区参数相同的两次采样才属于同一帧的副本
+inline bool sameFrame(const FrameDescriptor& a, const FrameDescriptor& b) {
+    return a.seq == b.seq && a.flags == b.flags && a.payloadBytes == b.payloadBytes && a.widthCount == b.widthCount &&
+        a.heightCount == b.heightCount && a.bitsPerModule == b.bitsPerModule && a.rsParity == b.rsParity;
+}
+
+int FrameFusion::add(SampledFrame& frame) {
+    size_t count = frame.bits.size();
+    if (captures == 0 || !sameFrame(group, frame.descriptor) || sums.size() != count) {
+        group = frame.descriptor;
+        captures = 0;
+        sums.assign(count, 0);
+    }
+    captures++;
+
+    for (size_t i = 0; i < count; ++i) {
+        int confidence = 255 - frame.validity[i];
+        int sum = sums[i] + (frame.bits[i] ? confidence : -confidence);
+        sum = min(max(sum, (int)INT16_MIN), (int)INT16_MAX);
+        sums[i] = (int16_t)sum;
+        if (sum != 0) {
+            frame.bits.set(i, sum > 0);
+        }
+        frame.validity[i] = (uint8_t)(255 - min(abs(sum), 255));
+    }
+    return captures;
+}
+
+bool Decoder::sample(const Mat& image, SampledFrame& frame) {
+    if (!locate(image, frame.descriptor)) {
+        return false;
+    }
+    sampleLocated(frame);
+    return true;
+}
+
+bool Decoder::locate(const Mat& image, FrameDescriptor& descriptor) {
+    ScopedTimer timer(STAGE_LOCATE);
+    return detectFrame(image, located, geometry, descriptor, gray, binary, color, binarizer);
+}
+
+void Decoder::sampleLocated(SampledFrame& frame) {
+    {
+        ScopedTimer timer(STAGE_SAMPLE);
+        sampleDataBits(located, geometry, frame.bits, frame.validity, frame.descriptor.bitsPerModule, &frame.descriptor);
+    }
+    countLowValidity(frame.validity, frame.descriptor.bitsPerModule, threshold);
+}
+
+// 纠错后解析帧头，取出本帧的数据块
+// 帧描述区的 rsParity > 0 时按交织的 RS(255, 255 - rsParity) 纠错（与编码器一致），否则按 9bit 奇偶校验解码；
+// 不可靠程度不小于 erasureThreshold 的字节作为擦除处理（0 = 不使用擦除）
+bool Decoder::correct(const SampledFrame& frame, FrameHeader& header, vector<uint8_t>& chunk) {
+    const FrameDescriptor& descriptor = frame.descriptor;
+    int rsParity = descriptor.rsParity;
+    lastRsParity = rsParity;
+    if (rsParity > 0) {
+        unpackBytes(frame.bits, raw);
+        raw.resize(rsEncodedSize(descriptor.payloadBytes, rsParity));
+        ambiguity.clear();
+        if (threshold > 0) {
+            byteAmbiguity(frame.validity, raw.size(), ambiguity);
+        }
+        RsDecodeStats before = rsStats;
+        {
+            ScopedTimer timer(STAGE_FEC);
+            bytes = rsDecodeFrame(raw, rsParity, ambiguity, threshold, rsStats);
+        }
+        metrics().count(COUNTER_CORRECTED_SYMBOLS, rsStats.correctedSymbols - before.correctedSymbols);
+        metrics().count(COUNTER_ERASURES, rsStats.erasures - before.erasures);
+        metrics().count(COUNTER_FAILED_BLOCKS, rsStats.failedBlocks - before.failedBlocks);
+        // 有码字无法纠正时整帧作废，等待同一帧的后续副本（融合后）再试，不把错误数据交给重组
+        if (rsStats.failedBlocks > before.failedBlocks) {
+            QRCODEC_LOG(LOG_DETAIL, "Uncorrectable RS blocks in frame " << descriptor.seq);
+            return false;
+        }
+    }
+    size_t parityErrors = 0;
+    if (rsParity == 0) {
+        vector<size_t> errors;
+        bytes = bitsToBytes(frame.bits, &errors);
+        bytes.resize(descriptor.payloadBytes);
+        // 只计数据区内的错误，其后的填充不影响数据块
+        parityErrors = lower_bound(errors.begin(), errors.end(), bytes.size()) - errors.begin();
+    }
+    if (bytes.size() <= FRAME_HEADER_SIZE || !parseFrameHeader(bytes.data(), header) ||
+        header.fountain != descriptor.fountain() || header.seq != descriptor.seq) {
+        QRCODEC_LOG(LOG_DETAIL, "Frame header not found");
+        return false;
+    }
+    header.compressed = descriptor.compressed();
+    header.parityErrors = parityErrors > 0;
+
+    // 喷泉码帧的数据区整体为一个编码符号，源符号数须与数据流长度一致
+    size_t payload = bytes.size() - FRAME_HEADER_SIZE;
+    bool valid = header.fountain
+        ? header.total == fountainSourceSymbols(header.length, payload)
+        : header.length <= payload;
+    if (!valid) {
+        QRCODEC_LOG(LOG_DETAIL, "Invalid frame header: seq " << header.seq << ", total " << header.total
+            << ", length " << header.length);
+        return false;
+    }
+
+    size_t length = header.fountain ? payload : header.length;
+    chunk.assign(bytes.begin() + FRAME_HEADER_SIZE, bytes.begin() + FRAME_HEADER_SIZE + length);
+    metrics().count(COUNTER_FRAMES);
+    return true;
+}
+
+bool Decoder::decode(const Mat& image, SampledFrame& frame, FrameHeader& header, vector<uint8_t>& chunk) {
+    return sample(image, frame) && correct(frame, header, chunk);
+}
+
+bool Decoder::decodeImage(const Mat& image, vector<uint8_t>& data, vector<uint8_t>& validity) {
+    // 检测并提取二维码；没有帧描述区的旧格式图像按图像尺寸推算网格
+    Mat qrImage;
+    FrameGeometry geometry;
+    FrameDescriptor descriptor;
+    bool described = detectFrame(image, qrImage, geometry, descriptor, gray, binary, color, binarizer) &&
+        descriptor.bitsPerModule == 1 && descriptor.rsParity == 0;
+    if (!described && !detectQRCode(image, qrImage, geometry)) {
+        cerr << "Failed to process QR code image" << endl;
+        return false;
+    }
+
+    QRCODEC_LOG(LOG_SUMMARY, "QR image size: " << qrImage.rows << "x" << qrImage.cols);
+
+    bool valid = false;
+    data = decodeQRCode(qrImage, geometry, validity, described ? &descriptor : nullptr, &valid);
+    // 压缩流校验通过后才解压；校验失败时返回压缩流供分析
+    if (described && descriptor.compressed() && valid) {
+        ScopedTimer timer(STAGE_COMPRESS);
+        vector<uint8_t> packed;
+        packed.swap(data);
+        if (!lzDecompressBuffer(packed, data)) {
+            QRCODEC_LOG(LOG_SUMMARY, "Decompression failed: corrupt compressed stream");
+            data.swap(packed);
+        }
+        else {
+            QRCODEC_LOG(LOG_SUMMARY, "Decompressed: " << packed.size() << " -> " << data.size() << " bytes");
+        }
+    }
+    return !data.empty();
+}
+
+// 会话文件：魔数 "QS"(2) + 版本(1) + 标志(1) + 总帧数(4) + 数据块长度(4) + 每帧有效性长度(4) + 末帧长度(4)
+//   + 数据流末尾的整体校验码(4)，其后为已收到位图（每帧 1 位，高位在前）和各数据块的 CRC32（每帧 4 字节），多字节字段为大端。
+// 位图与 CRC 逐块原地更新，数据块先写入输出文件再置位，中断后最多丢失正在写的一块。
+// 总帧数、压缩标志、两个长度和整体校验码标识所属的传输，续传时与收到的第一帧比对（见 matchesSession）
+const uint8_t SESSION_MAGIC[2] = { 'Q', 'S' };
+const int SESSION_VERSION = 2;
+const int SESSION_HEADER_SIZE = 24;
+const uint8_t SESSION_FLAG_COMPRESSED = 1;   // 数据流为压缩流
+const uint8_t SESSION_FLAG_STREAM_CRC = 2;   // 末帧已收到，整体校验码字段有效
+
+bool FrameAssembler::open(const string& dataFile, const string& validityFile, const string& sessionFile) {
+    dataPath = dataFile;
+    validityPath = validityFile;
+    sessionPath = sessionFile;
+    if (!sessionPath.empty() && loadSession()) {
+        // 续传：保留已有输出，只补收缺少的数据块
+        dataOut.open(dataFile, ios::in | ios::out | ios::binary);
+        validityOut.open(validityFile, ios::in | ios::out | ios::binary);
+        if (dataOut.is_open() && validityOut.is_open()) {
+            verifySessionChunks();
+            resumedCount = receivedFrames;
+            sessionUnconfirmed = true;
+            QRCODEC_LOG(LOG_SUMMARY, "Resuming session " << sessionPath << ": " << receivedFrames << " of "
+                << totalFrames << " frames already received");
+            return true;
+        }
+        // 输出文件不在了，从头开始
+        dataOut.close();
+        validityOut.close();
+        session.close();
+        resetProgress();
+    }
+    dataOut.open(dataFile, ios::in | ios::out | ios::trunc | ios::binary);
+    validityOut.open(validityFile, ios::binary);
+    return dataOut.is_open() && validityOut.is_open();
+}
+
+bool FrameAssembler::has(bool fountainFrame, uint32_t seq) const {
+    if (fountainFrame) {
+        return fountain && fountain->hasSymbol(seq);
+    }
+    // 会话尚未核对时不跳过任何帧：先由 add() 判断它们是否属于同一次传输
+    return !fountain && !sessionUnconfirmed && seq < totalFrames && received[seq] && !parityFailed[seq];
+}
+
+bool FrameAssembler::complete() const {
+    if (fountain) {
+        return fountain->complete();
+    }
+    return totalFrames > 0 && receivedFrames == totalFrames;
+}
+
+bool FrameAssembler::add(const FrameHeader& header, const vector<uint8_t>& chunk, const vector<uint8_t>& validity) {
+    if (sessionUnconfirmed) {
+        sessionUnconfirmed = false;
+        if (!matchesSession(header, chunk)) {
+            // 会话属于另一次传输：丢弃它和已有输出，按本次传输从头接收
+            cerr << "Session " << sessionPath << " belongs to a different transfer, receiving every frame again" << endl;
+            session.close();
+            resetProgress();
+            resumedCount = 0;
+            dataOut.close();
+            validityOut.close();
+            dataOut.open(dataPath, ios::in | ios::out | ios::trunc | ios::binary);
+            validityOut.open(validityPath, ios::binary);
+            if (!dataOut.is_open() || !validityOut.is_open()) {
+                return false;
+            }
+        }
+    }
+    if (!acceptCompression(header.compressed)) {
+        return false;
+    }
+    if (header.fountain) {
+        return addSymbol(header, chunk, validity);
+    }
+    if (fountain) {
+        return false;
+    }
+    if (totalFrames == 0) {
+        totalFrames = header.total;
+        received.assign(totalFrames, false);
+        parityFailed.assign(totalFrames, false);
+        if (!sessionPath.empty()) {
+            createSession();
+        }
+    }
+    else if (header.total != totalFrames) {
+        return false;
+    }
+    if (received[header.seq] && !parityFailed[header.seq]) {
+        return true;   // 已有无错的副本
+    }
+    parityFailed[header.seq] = header.parityErrors;
+
+    uint32_t lastSeq = totalFrames - 1;
+    if (header.seq < lastSeq) {
+        if (chunkStride == 0) {
+            chunkStride = chunk.size();
+            validityStride = validity.size();
+            if (session.is_open()) {
+                // 按总帧数预分配输出文件（稀疏），记下块长度后数据块即可在任意时刻原地写入
+                writeSessionHeader();
+                dataOut.flush();
+                filesystem::resize_file(dataPath, (uint64_t)totalFrames * chunkStride);
+            }
+        }
+        else if (chunk.size() != chunkStride) {
+            return false;
+        }
+        writeChunk(header.seq, chunk, validity);
+        if (lastPending) {
+            writeChunk(lastSeq, lastChunk, lastValidity);
+            lastPending = false;
+            vector<uint8_t>().swap(lastChunk);
+            vector<uint8_t>().swap(lastValidity);
+        }
+    }
+    else {
+        lastLength = chunk.size();
+        if (totalFrames == 1 || chunkStride > 0) {
+            writeChunk(header.seq, chunk, validity);
+        }
+        else {
+            lastChunk = chunk;
+            lastValidity = validity;
+            lastPending = true;
+        }
+    }
+
+    if (!received[header.seq]) {
+        received[header.seq] = true;
+        receivedFrames++;
+    }
+    return true;
+}
+
+AssemblyResult FrameAssembler::finish() {
+    if (fountain) {
+        QRCODEC_LOG(LOG_SUMMARY, "Fountain: " << fountain->receivedSymbols() << " symbols received, "
+            << fountain->recoveredSymbols() << " of " << fountain->sourceSymbols()
+            << " source symbols recovered");
+    }
+    if (!complete()) {
+        if (!fountain) {
+            QRCODEC_LOG(LOG_SUMMARY, "Missing frames: " << totalFrames - receivedFrames << " of " << totalFrames);
+        }
+        return ASSEMBLY_INCOMPLETE;
+    }
+
+    uint64_t length;
+    if (fountain) {
+        length = fountain->streamLength();
+        dataOut.seekp(0);
+        dataOut.write(reinterpret_cast<const char*>(fountain->data()), length);
+        fountain.reset();
+    }
+    else {
+        length = (uint64_t)(totalFrames - 1) * chunkStride + lastLength;
+    }
+    validityOut.close();
+
+    // 压缩流：解压后的数据流在输出文件中，收到的压缩流暂留到校验通过
+    uint64_t packedLength = length;
+    string packedPath = dataPath + ".lz";
+    bool valid = !compressedStream || decompressOutput(packedPath, length);
+    QRCODEC_LOG(LOG_SUMMARY, "Decoded bytes (with checksum): " << length);
+    valid = valid && verifyOutput(length);
+    dataOut.close();
+    if (compressedStream) {
+        if (valid) {
+            filesystem::remove(packedPath);
+        }
+        else {
+            filesystem::rename(packedPath, dataPath);
+            length = packedLength;
+        }
+    }
+    if (valid) {
+        filesystem::resize_file(dataPath, length - 4);  // 移除校验码，只留原始数据
+        QRCODEC_LOG(LOG_SUMMARY, "Data integrity verified");
+        if (session.is_open()) {
+            session.close();
+            filesystem::remove(sessionPath);
+        }
+    }
+    else {
+        cerr << "Warning: Data integrity check failed" << endl;
+        if (session.is_open()) {
+            // 会话中的 CRC 是按收到的字节算的，找不出坏块：删除会话，下次从头接收
+            filesystem::resize_file(dataPath, length);   // 去掉预分配多出的部分
+            session.close();
+            filesystem::remove(sessionPath);
+            cerr << "Session " << sessionPath << " discarded, the next run receives every frame again" << endl;
+        }
+    }
+    outputLength = valid ? length - 4 : length;
+    return valid ? ASSEMBLY_VERIFIED : ASSEMBLY_CORRUPT;
+}
+
+void FrameAssembler::writeChunk(uint32_t seq, const vector<uint8_t>& chunk, const vector<uint8_t>& validity) {
+    dataOut.seekp((streamoff)seq * chunkStride);
+    dataOut.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+    validityOut.seekp((streamoff)seq * validityStride);
+    validityOut.write(reinterpret_cast<const char*>(validity.data()), validity.size());
+    if (session.is_open() && !parityFailed[seq]) {
+        recordSessionChunk(seq, chunk);
+    }
+}
+
+// 读取会话文件头、位图和 CRC 区；格式不符时返回 false（调用方从头开始）
+bool FrameAssembler::loadSession() {
+    session.open(sessionPath, ios::in | ios::out | ios::binary);
+    uint8_t header[SESSION_HEADER_SIZE];
+    if (!session.read(reinterpret_cast<char*>(header), SESSION_HEADER_SIZE) ||
+        header[0] != SESSION_MAGIC[0] || header[1] != SESSION_MAGIC[1] || header[2] != SESSION_VERSION ||
+        readUint32BE(header + 4) == 0) {
+        session.close();
+        return false;
+    }
+    streamKnown = true;
+    compressedStream = (header[3] & SESSION_FLAG_COMPRESSED) != 0;
+    totalFrames = readUint32BE(header + 4);
+    chunkStride = readUint32BE(header + 8);
+    validityStride = readUint32BE(header + 12);
+    lastLength = readUint32BE(header + 16);
+    streamCrcKnown = (header[3] & SESSION_FLAG_STREAM_CRC) != 0;
+    streamCrc = readUint32BE(header + 20);
+    sessionBitmap.assign((totalFrames + 7) / 8, 0);
+    if (!session.read(reinterpret_cast<char*>(sessionBitmap.data()), sessionBitmap.size())) {
+        session.close();
+        resetProgress();
+        return false;
+    }
+    received.assign(totalFrames, false);
+    parityFailed.assign(totalFrames, false);
+    return true;
+}
+
+// 续传后收到的第一帧是否属于会话记录的传输：比对总帧数、压缩标志、数据块长度，
+// 第一帧是末帧且无奇偶校验错时再比对数据流末尾的整体校验码。只有已知的字段参与比对，
+// 参数相同的另一次传输仍可能被当作同一次，这时整体校验失败，会话照常被删除
+bool FrameAssembler::matchesSession(const FrameHeader& header, const vector<uint8_t>& chunk) const {
+    if (header.fountain || header.total != totalFrames || header.compressed != compressedStream) {
+        return false;
+    }
+    if (header.seq < totalFrames - 1) {
+        return chunkStride == 0 || chunk.size() == chunkStride;
+    }
+    if (lastLength > 0 && chunk.size() != lastLength) {
+        return false;
+    }
+    return !streamCrcKnown || header.parityErrors || chunk.size() < 4 ||
+        readUint32BE(chunk.data() + chunk.size() - 4) == streamCrc;
+}
+
+// 清除接收进度（会话无效或属于另一次传输时从头开始）
+void FrameAssembler::resetProgress() {
+    totalFrames = receivedFrames = 0;
+    chunkStride = validityStride = lastLength = 0;
+    streamKnown = compressedStream = false;
+    streamCrcKnown = false;
+    streamCrc = 0;
+    received.clear();
+    parityFailed.clear();
+    sessionBitmap.clear();
+}
+
+// 按会话文件记录的 CRC 回读并复核已收到的数据块，不符的（输出文件被改动或写到一半）清除后重新接收
+void FrameAssembler::verifySessionChunks() {
+    ScopedTimer timer(STAGE_VERIFY);
+    streamoff crcStart = SESSION_HEADER_SIZE + (streamoff)sessionBitmap.size();
+    vector<uint8_t> chunk(chunkStride);
+    receivedFrames = 0;
+    for (uint32_t seq = 0; seq < totalFrames; ++seq) {
+        if (!((sessionBitmap[seq / 8] >> (7 - seq % 8)) & 1)) {
+            continue;
+        }
+        size_t length = (seq == totalFrames - 1) ? lastLength : chunkStride;
+        uint8_t stored[4];
+        chunk.resize(length);
+        session.seekg(crcStart + (streamoff)seq * 4);
+        dataOut.seekg((streamoff)seq * chunkStride);
+        bool valid = length > 0 && session.read(reinterpret_cast<char*>(stored), 4) &&
+            dataOut.read(reinterpret_cast<char*>(chunk.data()), length) &&
+            crc32Update(0, chunk) == readUint32BE(stored);
+        if (!valid) {
+            session.clear();
+            dataOut.clear();
+            sessionBitmap[seq / 8] &= (uint8_t)~(0x80 >> (seq % 8));
+            session.seekp(SESSION_HEADER_SIZE + seq / 8);
+            session.put((char)sessionBitmap[seq / 8]);
+            QRCODEC_LOG(LOG_DETAIL, "Session chunk " << seq << " failed its CRC, receiving it again");
+            continue;
+        }
+        received[seq] = true;
+        receivedFrames++;
+    }
+    session.flush();
+}
+
+// 总帧数确定后建立会话文件：文件头、全零位图和 CRC 区
+void FrameAssembler::createSession() {
+    session.open(sessionPath, ios::in | ios::out | ios::trunc | ios::binary);
+    if (!session.is_open()) {
+        cerr << "Cannot create session file: " << sessionPath << endl;
+        return;
+    }
+    sessionBitmap.assign((totalFrames + 7) / 8, 0);
+    writeSessionHeader();
+    session.write(reinterpret_cast<const char*>(sessionBitmap.data()), sessionBitmap.size());
+    vector<char> crcs((size_t)totalFrames * 4, 0);
+    session.write(crcs.data(), crcs.size());
+    session.flush();
+}
+
+void FrameAssembler::writeSessionHeader() {
+    uint8_t flags = (uint8_t)((compressedStream ? SESSION_FLAG_COMPRESSED : 0) | (streamCrcKnown ? SESSION_FLAG_STREAM_CRC : 0));
+    uint8_t header[SESSION_HEADER_SIZE] = { SESSION_MAGIC[0], SESSION_MAGIC[1], (uint8_t)SESSION_VERSION, flags };
+    writeUint32BE(header + 4, totalFrames);
+    writeUint32BE(header + 8, (uint32_t)chunkStride);
+    writeUint32BE(header + 12, (uint32_t)validityStride);
+    writeUint32BE(header + 16, (uint32_t)lastLength);
+    writeUint32BE(header + 20, streamCrc);
+    session.seekp(0);
+    session.write(reinterpret_cast<const char*>(header), SESSION_HEADER_SIZE);
+}
+
+// 数据块已写入输出文件后记下其 CRC32 并置位；输出先刷新，会话文件中置位的数据块一定已在输出文件中
+void FrameAssembler::recordSessionChunk(uint32_t seq, const vector<uint8_t>& chunk) {
+    dataOut.flush();
+    validityOut.flush();
+    uint8_t crc[4];
+    writeUint32BE(crc, crc32Update(0, chunk));
+    if (seq == totalFrames - 1) {
+        if (chunk.size() >= 4) {
+            streamCrc = readUint32BE(chunk.data() + chunk.size() - 4);
+            streamCrcKnown = true;
+        }
+        writeSessionHeader();   // 末帧长度与整体校验码
+    }
+    session.seekp(SESSION_HEADER_SIZE + (streamoff)sessionBitmap.size() + (streamoff)seq * 4);
+    session.write(reinterpret_cast<const char*>(crc), 4);
+    sessionBitmap[seq / 8] |= (uint8_t)(0x80 >> (seq % 8));
+    session.seekp(SESSION_HEADER_SIZE + seq / 8);
+    session.put((char)sessionBitmap[seq / 8]);
+    session.flush();
+}
+
+bool FrameAssembler::addSymbol(const FrameHeader& header, const vector<uint8_t>& chunk,
+    const vector<uint8_t>& validity) {
+    if (totalFrames > 0 && !fountain) {
+        return false;
+    }
+    if (!fountain) {
+        fountain.reset(new FountainDecoder(header.total, chunk.size(), header.length));
+    }
+    else if (header.total != fountain->sourceSymbols() || header.length != fountain->streamLength() ||
+        chunk.size() != fountain->symbolBytes()) {
+        return false;
+    }
+
+    if (fountain->addSymbol(header.seq, chunk.data())) {
+        validityOut.write(reinterpret_cast<const char*>(validity.data()), validity.size());
+    }
+    return true;
+}
+
+// 数据流是否压缩由首帧确定，之后的帧须一致
+bool FrameAssembler::acceptCompression(bool compressed) {
+    if (!streamKnown) {
+        streamKnown = true;
+        compressedStream = compressed;
+    }
+    return compressed == compressedStream;
+}
+
+// 把输出文件中 length 字节的压缩流改名为 packedPath，逐块解压回输出文件，length 改为解压后的长度。
+// 压缩流损坏时返回 false
+bool FrameAssembler::decompressOutput(const string& packedPath, uint64_t& length) {
+    ScopedTimer timer(STAGE_COMPRESS);
+    dataOut.close();
+    filesystem::resize_file(dataPath, length);   // 去掉会话预分配多出的部分
+    filesystem::rename(dataPath, packedPath);
+    ifstream packed(packedPath, ios::binary);
+    dataOut.open(dataPath, ios::in | ios::out | ios::trunc | ios::binary);
+    uint64_t written = 0;
+    bool decoded = lzDecodeStream(
+        [&packed](uint8_t* out, size_t n) { return (bool)packed.read(reinterpret_cast<char*>(out), n); },
+        length,
+        [this, &written](const uint8_t* data, size_t n) {
+            dataOut.write(reinterpret_cast<const char*>(data), n);
+            written += n;
+        });
+    if (!decoded) {
+        QRCODEC_LOG(LOG_SUMMARY, "Decompression failed: corrupt compressed stream");
+        return false;
+    }
+    QRCODEC_LOG(LOG_SUMMARY, "Decompressed: " << length << " -> " << written << " bytes");
+    length = written;
+    return true;
+}
+
+// 按块顺序回读前 length - 4 字节计算 CRC32，与末尾 4 字节比较（与 verifyChecksum 一致）
+bool FrameAssembler::verifyOutput(uint64_t length) {
+    ScopedTimer timer(STAGE_VERIFY);
+    if (length < 4) {
+        QRCODEC_LOG(LOG_SUMMARY, "Data too short for checksum verification");
+        return false;
+    }
+    dataOut.flush();
+    dataOut.seekg(0);
+    vector<uint8_t> block(1 << 20);
+    uint32_t crc = 0;
+    for (uint64_t remaining = length - 4; remaining > 0; ) {
+        size_t n = (size_t)min<uint64_t>(block.size(), remaining);
+        if (!dataOut.read(reinterpret_cast<char*>(block.data()), n)) {
+            break;
+        }
+        ScopedTimer crcTimer(STAGE_CRC);
+        crc = crc32Update(crc, block.data(), n);
+        remaining -= n;
+    }
+    uint8_t stored[4];
+    if (!dataOut.read(reinterpret_cast<char*>(stored), 4)) {
+        QRCODEC_LOG(LOG_SUMMARY, "Checksum verification failed: could not read back output");
+        return false;
+    }
+    return reportChecksum(readUint32BE(stored), crc);
+}
@@ -1,268 +1,425 @@
 #include <opencv2/opencv.hpp>
 #include <iostream>
-#include <fstream>
 #include <vector>
-#include <bitset>
 #include <cmath>
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+
+#include "codec.h"
+#include "crc32.h"
+#include "modulation.h"
+#include "fountain.h"
+#include "mappedFile.h"
+#include "frameSink.h"
+#include "lz77.h"
 
 using namespace cv;
 using namespace std;
 
-// 每模块像素大小
-const int MODULE_SIZE = 10;
-const int BORDER = 4;
+// 命令行编码器：参数解析与文件读写，逐帧编码见 codec.h / encoder.cpp
 
-// 定位标记大小
-const int FINDER_PATTERN_SIZE = 7;
-const int FINDER_BORDER = 1;
+// 流式编码的数据流：映射的输入文件之后接 4 字节 CRC32（大端，与 addChecksum 相同）。
+// 不复制文件内容；CRC 随顺序读取推进，读到校验码时补算剩余部分
+class ChecksummedStream {
+public:
+    explicit ChecksummedStream(MappedFile& file) : file(file) {}
 
-// 读取二进制文件
-vector<uint8_t> readBinaryFile(const string& filename) {
-    ifstream ifs(filename, ios::binary);
-    vector<uint8_t> data;
-    if (!ifs) return data;
-    ifs.seekg(0, ios::end);
-    size_t size = ifs.tellg();
-    ifs.seekg(0, ios::beg);
-    data.resize(size);
-    ifs.read(reinterpret_cast<char*>(data.data()), size);
-    return data;
-}
+    size_t size() const {
+        return file.size() + 4;
+    }
 
-// 计算CRC32校验码
-uint32_t calculateCRC32(const vector<uint8_t>& data) {
-    uint32_t crc = 0xFFFFFFFF;
-    uint32_t polynomial = 0xEDB88320;
+    void read(size_t offset, size_t length, uint8_t* out) {
+        size_t fileSize = file.size();
+        size_t end = offset + length;
+        if (offset < fileSize) {
+            ScopedTimer timer(STAGE_READ);
+            memcpy(out, file.data() + offset, min(end, fileSize) - offset);
+        }
+        if (offset <= crcOffset || end > fileSize) {
+            advanceCrc(min(end, fileSize));
+        }
+        for (size_t i = max(offset, fileSize); i < end; ++i) {
+            out[i - offset] = (uint8_t)(crc >> (8 * (3 - (i - fileSize))));
+        }
+    }
 
-    for (auto byte : data) {
-        crc ^= byte;
-        for (int i = 0; i < 8; i++) {
-            if (crc & 1) {
-                crc = (crc >> 1) ^ polynomial;
-            }
-            else {
-                crc >>= 1;
+    // 顺序编码时 [0, end) 已不再需要
+    void release(size_t end) {
+        end = min(end, crcOffset);
+        if (end > released) {
+            file.release(released, end - released);
+            released = end / MappedFile::PAGE_BYTES * MappedFile::PAGE_BYTES;
+        }
+    }
+
+    // 再次从头顺序读取前调用，之后 release 重新释放读过的页
+    void rewind() {
+        released = 0;
+    }
+
+private:
+    void advanceCrc(size_t end) {
+        if (end > crcOffset) {
+            ScopedTimer timer(STAGE_CRC);
+            crc = crc32Update(crc, file.data() + crcOffset, end - crcOffset);
+            crcOffset = end;
+        }
+    }
+
+    MappedFile& file;
+    uint32_t crc = 0;
+    size_t crcOffset = 0;
+    size_t released = 0;
+};
+
+// 交给帧编码的数据流：ChecksummedStream 本身，或 --compress 时它的压缩流（见 lz77.h）。
+// 校验码在压缩之前计算，接收端解压后验证，覆盖压缩与解压本身
+class FrameStream {
+public:
+    explicit FrameStream(ChecksummedStream& stream) : stream(stream) {}
+
+    // 改为发送压缩流：先整体压缩一遍求出压缩流长度。
+    // sequential 为 true 时编码时再按需压缩并按顺序释放读过的页；为 false 时（喷泉码随机读取源符号）
+    // 保留第一遍的压缩流，不再重复压缩。没有一块能变短时保持不压缩并返回 false
+    bool compress(bool sequential) {
+        ScopedTimer timer(STAGE_COMPRESS);
+        packed.reset(new LzStreamEncoder(stream.size(), [this, sequential](size_t offset, size_t length, uint8_t* out) {
+            stream.read(offset, length, out);
+            if (sequential) {
+                stream.release(offset + length);
             }
+        }, !sequential));
+        stream.rewind();
+        if (packed->compressedBlocks() == 0) {
+            packed.reset();
+            return false;
         }
+        return true;
     }
-    return ~crc;
-}
 
-// 添加校验码到数据
-vector<uint8_t> addChecksum(const vector<uint8_t>& data) {
-    vector<uint8_t> result = data;
-    uint32_t checksum = calculateCRC32(data);
+    bool compressed() const {
+        return packed != nullptr;
+    }
 
-    // 将32位校验码分成4个字节添加到数据末尾
-    result.push_back((checksum >> 24) & 0xFF);
-    result.push_back((checksum >> 16) & 0xFF);
-    result.push_back((checksum >> 8) & 0xFF);
-    result.push_back(checksum & 0xFF);
+    size_t size() const {
+        return packed ? packed->size() : stream.size();
+    }
 
-    return result;
-}
+    void read(size_t offset, size_t length, uint8_t* out) {
+        if (packed) {
+            ScopedTimer timer(STAGE_COMPRESS);
+            packed->read(offset, length, out);
+        }
+        else {
+            stream.read(offset, length, out);
+        }
+    }
 
-// 添加奇偶校验，返回每字节 9bit（存储为 bool 向量）
-vector<bool> addParityBits(const vector<uint8_t>& data) {
-    vector<bool> bits;
-    for (auto byte : data) {
-        bitset<8> b(byte);
-        bool parity = b.count() % 2; // 奇偶校验位，1 = 奇数个 1
-        for (int i = 7; i >= 0; --i) {
-            bits.push_back(b[i]);
+    // 顺序编码时 [0, end) 已不再需要（压缩流在读取源数据时释放）
+    void release(size_t end) {
+        if (!packed) {
+            stream.release(end);
         }
-        bits.push_back(parity); // 加到末尾
     }
-    return bits;
+
+private:
+    ChecksummedStream& stream;
+    std::unique_ptr<LzStreamEncoder> packed;
+};
+
+// 生成二维码图片（sink 只取 PNG 压缩参数）
+void encodeToQRCode(const vector<uint8_t>& data, const string& outImage, const SinkSpec& sink, bool compress) {
+    Mat qrImage;
+    encodeSingleImage(data, qrImage, compress);
+    {
+        ScopedTimer timer(STAGE_IMWRITE);
+        imwrite(outImage, qrImage, pngWriteParams(sink));
+    }
+    QRCODEC_LOG(LOG_SUMMARY, "QRCode image generated: " << outImage);
 }
 
-// 绘制定位标记
-void drawFinderPattern(Mat& qrImage, int centerX, int centerY) {
-    int startX = centerX - FINDER_PATTERN_SIZE / 2;
-    int startY = centerY - FINDER_PATTERN_SIZE / 2;
-
-    // 绘制外黑框
-    for (int y = 0; y < FINDER_PATTERN_SIZE; ++y) {
-        for (int x = 0; x < FINDER_PATTERN_SIZE; ++x) {
-            int value = 0; // 黑色
-            if (x >= FINDER_BORDER && x < FINDER_PATTERN_SIZE - FINDER_BORDER &&
-                y >= FINDER_BORDER && y < FINDER_PATTERN_SIZE - FINDER_BORDER) {
-                value = 255; // 内部白色
-            }
-            if (x >= FINDER_BORDER + 1 && x < FINDER_PATTERN_SIZE - FINDER_BORDER - 1 &&
-                y >= FINDER_BORDER + 1 && y < FINDER_PATTERN_SIZE - FINDER_BORDER - 1) {
-                value = 0; // 中心黑色
-            }
+// 流式编码：按目标分辨率把数据切成固定大小的块，每块生成一帧并立即交给输出端（见 frameSink.h）
+// rsParity > 0 时每帧使用交织的 RS(255, 255 - rsParity) 纠错码（每字节 8bit），否则使用每字节 9bit 奇偶校验
+// bitsPerModule 为每模块承载的比特数（1 = 黑白，2 = 4 级灰度，3 = 8 色）
+// fountainOverhead >= 0 时改为输出 LT 喷泉码符号：k 个系统符号之后再追加 k * fountainOverhead% 个冗余符号，
+// 接收端收到任意略多于 k 帧即可恢复（见 fountain.h）
+// config.chunkBytes 不为 0 时（容量规划的结果）每帧只装这么多数据
+// stream 为压缩流时每帧的帧描述区带压缩标志
+bool encodeToFrames(FrameStream& stream, const string& output, const SinkSpec& sinkSpec,
+    const EncoderConfig& config, int fountainOverhead) {
+    int frameWidth = config.frameWidth;
+    int frameHeight = config.frameHeight;
+    int rsParity = config.rsParity;
+    int bitsPerModule = config.bitsPerModule;
+    Encoder encoder;
+    if (!encoder.configure(config)) {
+        cerr << "Error: Frame resolution too small" << endl;
+        return false;
+    }
+    size_t chunkSize = encoder.chunkBytes();
 
-            for (int py = 0; py < MODULE_SIZE; ++py) {
-                for (int px = 0; px < MODULE_SIZE; ++px) {
-                    int pixelX = (startX + x) * MODULE_SIZE + px;
-                    int pixelY = (startY + y) * MODULE_SIZE + py;
-                    if (pixelX >= 0 && pixelX < qrImage.cols &&
-                        pixelY >= 0 && pixelY < qrImage.rows) {
-                        qrImage.at<uint8_t>(pixelY, pixelX) = value;
-                    }
-                }
-            }
+    // 校验码覆盖整个文件，随最后一帧发送；帧头中的帧序号和总帧数为 32 位
+    uint64_t frameCount = ((uint64_t)stream.size() + chunkSize - 1) / chunkSize;
+    if (frameCount > UINT32_MAX) {
+        cerr << "Error: " << frameCount << " frames exceed the 32-bit frame count, use a larger frame" << endl;
+        return false;
+    }
+    uint32_t totalFrames = (uint32_t)frameCount;
+
+    // 喷泉码编码器只在喷泉码模式下建立：它按源符号数分配度分布表，顺序编码用不到
+    bool fountainMode = fountainOverhead >= 0;
+    unique_ptr<FountainEncoder> fountain;
+    if (fountainMode) {
+        // 喷泉码帧头中的数据流总长度为 32 位，度分布按 int 计算源符号数
+        if ((uint64_t)stream.size() > UINT32_MAX || frameCount > INT_MAX) {
+            cerr << "Error: Fountain mode needs a stream below 4 GiB and " << INT_MAX << " source symbols, got "
+                << stream.size() << " bytes in " << frameCount << " symbols" << endl;
+            return false;
         }
+        fountain.reset(new FountainEncoder(stream.size(), chunkSize,
+            [&stream](size_t offset, size_t length, uint8_t* out) { stream.read(offset, length, out); }));
+        uint64_t symbolCount = fountain->sourceSymbols() + (uint64_t)ceil(fountain->sourceSymbols() * fountainOverhead / 100.0);
+        if (symbolCount > UINT32_MAX) {
+            cerr << "Error: " << symbolCount << " fountain symbols exceed the 32-bit symbol id, lower --fountain" << endl;
+            return false;
+        }
+        totalFrames = (uint32_t)symbolCount;
     }
-}
 
-// 绘制对齐标记（简化版）
-void drawAlignmentPattern(Mat& qrImage, int centerX, int centerY) {
-    int size = 5;
-    int startX = centerX - size / 2;
-    int startY = centerY - size / 2;
-
-    for (int y = 0; y < size; ++y) {
-        for (int x = 0; x < size; ++x) {
-            int value = 0; // 黑色
-            if (x >= 1 && x < size - 1 && y >= 1 && y < size - 1) {
-                value = 255; // 白色
-            }
-            if (x >= 2 && x < size - 2 && y >= 2 && y < size - 2) {
-                value = 0; // 中心黑色
-            }
+    string error;
+    unique_ptr<FrameSink> sink = openFrameSink(sinkSpec, output, Size(frameWidth, frameHeight),
+        encoder.frameType() == CV_8UC3, error);
+    if (!sink) {
+        cerr << "Error: " << error << endl;
+        return false;
+    }
 
-            for (int py = 0; py < MODULE_SIZE; ++py) {
-                for (int px = 0; px < MODULE_SIZE; ++px) {
-                    int pixelX = (startX + x) * MODULE_SIZE + px;
-                    int pixelY = (startY + y) * MODULE_SIZE + py;
-                    if (pixelX >= 0 && pixelX < qrImage.cols &&
-                        pixelY >= 0 && pixelY < qrImage.rows) {
-                        qrImage.at<uint8_t>(pixelY, pixelX) = value;
-                    }
-                }
-            }
+    vector<uint8_t> chunk(chunkSize);
+    Mat qrImage(frameHeight, frameWidth, encoder.frameType());
+
+    auto start = chrono::steady_clock::now();
+    for (uint32_t seq = 0; seq < totalFrames; ++seq) {
+        FrameHeader header;
+        header.fountain = fountainMode;
+        header.seq = seq;
+        header.compressed = stream.compressed();
+        if (fountainMode) {
+            fountain->encodeSymbol(seq, chunk.data());
+            header.total = fountain->sourceSymbols();
+            header.length = (uint32_t)stream.size();
         }
-    }
-}
+        else {
+            size_t offset = (size_t)seq * chunkSize;
+            header.total = totalFrames;
+            header.length = (uint32_t)min(chunkSize, stream.size() - offset);
+            stream.read(offset, header.length, chunk.data());
+            stream.release(offset + header.length);
+        }
+        encoder.encodeFrame(header, chunk.data(), qrImage);
 
-// 生成二维码图片
-void encodeToQRCode(const vector<uint8_t>& data, const string& outImage) {
-    // 添加校验码
-    vector<uint8_t> dataWithChecksum = addChecksum(data);
-
-    vector<bool> bits = addParityBits(dataWithChecksum);
-
-    // 计算二维码模块数（最小正方形）
-    //int moduleCount = ceil(sqrt(bits.size()));
-    const float desired_aspect_ratio = 16.0 / 9.0;
-
-    // 高度模块数量（向上取整，避免不足）
-    int heightCount = ceil(sqrt(bits.size() / desired_aspect_ratio));
-
-    // 宽度模块数量
-    int widthCount = ceil(heightCount * desired_aspect_ratio);
-
-    // 确保有足够空间放置定位标记
-    //moduleCount = max(moduleCount, FINDER_PATTERN_SIZE + 2);
-    heightCount = max(heightCount, FINDER_PATTERN_SIZE + 2);//height的更小
-
-    // 计算实际二维码大小（包含边框）
-    //int qrSize = moduleCount + 2 * BORDER;
-    int qrWidthInModules = widthCount + 2 * BORDER;
-    int qrHeightInModules = heightCount + 2 * BORDER;
-
-    // 创建二维码图像
-    //Mat qrImage = Mat::zeros(qrSize * MODULE_SIZE, qrSize * MODULE_SIZE, CV_8UC1);
-    Mat qrImage = Mat(qrHeightInModules * MODULE_SIZE,
-        qrWidthInModules * MODULE_SIZE, CV_8UC1);
-    qrImage.setTo(255); // 白色背景
-    
-    // 绘制三个定位标记（左上、右上、左下）
-    /*drawFinderPattern(qrImage, BORDER + FINDER_PATTERN_SIZE / 2,
-        BORDER + FINDER_PATTERN_SIZE / 2);
-    drawFinderPattern(qrImage, BORDER + moduleCount - FINDER_PATTERN_SIZE / 2 - 1,
-        BORDER + FINDER_PATTERN_SIZE / 2);
-    drawFinderPattern(qrImage, BORDER + FINDER_PATTERN_SIZE / 2,
-        BORDER + moduleCount - FINDER_PATTERN_SIZE / 2 - 1);*/
-    drawFinderPattern(qrImage, BORDER + FINDER_PATTERN_SIZE / 2,
-        BORDER + FINDER_PATTERN_SIZE / 2);
-    drawFinderPattern(qrImage,
-        qrWidthInModules - BORDER - FINDER_PATTERN_SIZE / 2 - 1,
-        BORDER + FINDER_PATTERN_SIZE / 2);
-    drawFinderPattern(qrImage,
-        BORDER + FINDER_PATTERN_SIZE / 2,
-        qrHeightInModules - BORDER - FINDER_PATTERN_SIZE / 2 - 1);
-
-    // 绘制对齐标记（右下角）
-    /*if (moduleCount > 15) {
-        drawAlignmentPattern(qrImage, BORDER + moduleCount - 4, BORDER + moduleCount - 4);
-    }*/
-    if (widthCount > 15 && heightCount > 15) {
-        drawAlignmentPattern(
-            qrImage,
-            BORDER + widthCount - 4,
-            BORDER + heightCount - 4
-        );
+        ScopedTimer timer(STAGE_IMWRITE);
+        if (!sink->write(seq, qrImage)) {
+            cerr << "Error: " << sink->error() << endl;
+            return false;
+        }
     }
+    {
+        ScopedTimer timer(STAGE_IMWRITE);
+        if (!sink->close()) {
+            cerr << "Error: Could not finish writing " << output << endl;
+            return false;
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    QRCODEC_LOG(LOG_SUMMARY, "Frames generated: " << totalFrames << " (" << output
+        << ((sinkSpec.kind == SINK_PNG) ? "_NNNNNN.png" : (sinkSpec.kind == SINK_PGM) ? "_NNNNNN.pgm" : "") << ")");
+    QRCODEC_LOG(LOG_SUMMARY, "Data size: " << stream.size() - (stream.compressed() ? 0 : 4) << " bytes"
+        << (stream.compressed() ? " (compressed stream)" : ""));
+    QRCODEC_LOG(LOG_SUMMARY, "Frame size: " << frameWidth << "x" << frameHeight << " (" << encoder.widthCount()
+        << "x" << encoder.heightCount() << " modules of " << config.moduleSize << " px)");
+    QRCODEC_LOG(LOG_SUMMARY, "Payload per frame: " << chunkSize << " bytes");
+    if (rsParity > 0) {
+        QRCODEC_LOG(LOG_SUMMARY, "FEC: RS(255," << 255 - rsParity << "), interleaved");
+    }
+    if (fountainMode) {
+        QRCODEC_LOG(LOG_SUMMARY, "Fountain: " << fountain->sourceSymbols() << " source symbols, "
+            << totalFrames - fountain->sourceSymbols() << " repair symbols");
+    }
+    QRCODEC_LOG(LOG_SUMMARY, "Modulation: " << bitsPerModule << " bit(s) per module");
+    QRCODEC_LOG(LOG_SUMMARY, "Elapsed: " << seconds << " s, " << totalFrames / max(seconds, 1e-9) << " frames/s");
+    return true;
+}
 
-    // 绘制数据模块
-    int idx = 0;
-    for (int y = 0; y < heightCount; ++y) {
-        for (int x = 0; x < widthCount; ++x) {
-            // 跳过定位标记区域
-            bool isFinderArea = false;
-
-            // 左上定位标记
-            if (x < FINDER_PATTERN_SIZE + FINDER_BORDER &&
-                y < FINDER_PATTERN_SIZE + FINDER_BORDER) {
-                isFinderArea = true;
-            }
-            // 右上定位标记
-            if (x >= widthCount - FINDER_PATTERN_SIZE - FINDER_BORDER &&
-                y < FINDER_PATTERN_SIZE + FINDER_BORDER) {
-                isFinderArea = true;
-            }
-            // 左下定位标记
-            if (x < FINDER_PATTERN_SIZE + FINDER_BORDER &&
-                y >= heightCount - FINDER_PATTERN_SIZE - FINDER_BORDER) {
-                isFinderArea = true;
-            }
-            // 对齐标记区域
-            if (widthCount > 15 && heightCount > 15 &&
-                x >= widthCount - 6 && x < widthCount - 2 &&
-                y >= heightCount - 6 && y < heightCount - 2) {
-                isFinderArea = true;
+int main(int argc, char** argv) {
+    // 解析选项，其余为位置参数
+    bool streamMode = false;
+    int frameWidth = 0, frameHeight = 0;
+    int rsDataBytes = 223;
+    int bitsPerModule = 1;
+    int fountainOverhead = -1;
+    int moduleSize = MODULE_SIZE;
+    bool plan = false;
+    bool compress = false;
+    double fps = 30;
+    SinkSpec sink;
+    string metricsFile;
+    vector<string> args;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--stream" && i + 1 < argc) {
+            streamMode = true;
+            if (sscanf(argv[++i], "%dx%d", &frameWidth, &frameHeight) != 2) {
+                cerr << "Error: Invalid resolution " << argv[i] << endl;
+                return 1;
             }
-
-            if (!isFinderArea && idx < bits.size()) {
-                int value = bits[idx++] ? 0 : 255; // 黑 = 1, 白 = 0
-                rectangle(qrImage,
-                    Point((x + BORDER) * MODULE_SIZE, (y + BORDER) * MODULE_SIZE),
-                    Point((x + BORDER + 1) * MODULE_SIZE - 1, (y + BORDER + 1) * MODULE_SIZE - 1),
-                    Scalar(value), FILLED);
+        }
+        else if (arg == "--rs" && i + 1 < argc) {
+            rsDataBytes = atoi(argv[++i]);
+        }
+        else if (arg == "--bits-per-module" && i + 1 < argc) {
+            bitsPerModule = atoi(argv[++i]);
+        }
+        else if (arg == "--fountain" && i + 1 < argc) {
+            fountainOverhead = atoi(argv[++i]);
+        }
+        else if (arg == "--module-size" && i + 1 < argc) {
+            moduleSize = atoi(argv[++i]);
+        }
+        else if (arg == "--plan") {
+            plan = true;
+        }
+        else if (arg == "--compress") {
+            compress = true;
+        }
+        else if (arg == "--fps" && i + 1 < argc) {
+            fps = atof(argv[++i]);
+        }
+        else if (arg == "--sink" && i + 1 < argc) {
+            if (!parseSinkSpec(argv[++i], sink)) {
+                cerr << "Error: Invalid sink " << argv[i] << endl;
+                return 1;
             }
         }
+        else if (arg == "--quiet") {
+            setLogLevel(LOG_QUIET);
+        }
+        else if (arg == "--verbose") {
+            setLogLevel(LOG_DETAIL);
+        }
+        else if (arg == "--metrics" && i + 1 < argc) {
+            metricsFile = argv[++i];
+        }
+        else {
+            args.push_back(arg);
+        }
     }
 
-    imwrite(outImage, qrImage);
-    cout << "QRCode image generated: " << outImage << endl;
-    cout << "Data size: " << data.size() << " bytes" << endl;
-    cout << "With checksum: " << dataWithChecksum.size() << " bytes" << endl;
-    cout << "QR Code size: " << widthCount << "x" << heightCount << " y" << endl;
-
-    cout << "Total bits (with parity): " << bits.size() << endl;
-    cout << "Bits actually written: " << idx << endl;
-}
+    if (args.size() != 2 || rsDataBytes < 0 || rsDataBytes > 254 || (fountainOverhead >= 0 && !streamMode) ||
+        moduleSize < 3 || moduleSize > 255 || (moduleSize != MODULE_SIZE && !streamMode) ||
+        bitsPerModule < 1 || bitsPerModule > MAX_BITS_PER_MODULE || (plan && !streamMode) || !(fps > 0) ||
+        (sink.kind != SINK_PNG && !streamMode)) {
+        cout << "Usage: encode [--quiet|--verbose] [--metrics file] [--compress] [--sink png:N] <input_bin> <output_png>\n";
+        cout << "       encode [--quiet|--verbose] [--metrics file] --stream <width>x<height> [--module-size S] [--rs K]\n";
+        cout << "              [--bits-per-module B] [--fountain P] [--plan [--fps F]] [--compress] [--sink SINK]\n";
+        cout << "              <input_bin> <output>\n";
+        cout << "       --module-size S: module size in pixels, 3..255 (default " << MODULE_SIZE << ")\n";
+        cout << "       --plan: treat S as the minimum module size and let the capacity planner pick the module size\n";
+        cout << "               and per-frame payload that need the fewest frames (most bytes/s at F fps, default 30)\n";
+        cout << "       --rs K: RS(255,K) per frame, 1..254 (default 223), 0 = per-byte parity\n";
+        cout << "       --bits-per-module B: 1 = black/white (default), 2 = 4 gray levels, 3 = 8 colors\n";
+        cout << "       --fountain P: emit LT fountain-coded frames, P% repair frames beyond the source frames\n";
+        cout << "       --compress: LZ77-compress the data in 64 KiB blocks, blocks that do not shrink are sent as is\n";
+        cout << "       --sink SINK: png (default, <output>_NNNNNN.png), png:N (zlib level N, RLE strategy),\n";
+        cout << "                    pgm (uncompressed <output>_NNNNNN.pgm), raw (all frames' pixels into one file,\n";
+        cout << "                    - = stdout), video[:F] (one FFV1 lossless video at F fps, default 30)\n";
+        cout << "       --quiet: print errors only; --verbose: per-frame details (builds with QRCODEC_LOG_LEVEL=2)\n";
+        cout << "       --metrics file: write per-stage timings and counters as JSON when done (- = stdout)\n";
+        return 1;
+    }
 
-int main(int argc, char** argv) {
-    if (argc != 3) {
-        cout << "Usage: encode <input_bin> <output_png>\n";
+    // 帧像素写到标准输出时日志改走标准错误，统计 JSON 不能再写标准输出
+    bool rawStdout = sink.kind == SINK_RAW && args[1] == "-";
+    if (rawStdout && metricsFile == "-") {
+        cerr << "Error: --metrics - cannot share stdout with --sink raw -" << endl;
         return 1;
     }
+    if (!metricsFile.empty()) {
+        metrics().enable();
+    }
+    if (rawStdout) {
+        setLogStream(cerr);
+    }
 
-    string inputFile = argv[1];
-    string outputFile = argv[2];
+    string inputFile = args[0];
+    string outputFile = args[1];
 
-    vector<uint8_t> data = readBinaryFile(inputFile);
-    if (data.empty()) {
-        cout << "Error: Could not read input file or file is empty\n";
+    // 输入按需映射，流式模式下内存占用与文件大小无关
+    MappedFile input;
+    if (!input.open(inputFile) || input.size() == 0) {
+        cerr << "Error: Could not read input file or file is empty\n";
         return 1;
     }
 
-    encodeToQRCode(data, outputFile);
+    if (streamMode) {
+        int rsParity = (rsDataBytes > 0) ? 255 - rsDataBytes : 0;
+        ChecksummedStream checksummed(input);
+        FrameStream stream(checksummed);
+        if (compress) {
+            if (stream.compress(fountainOverhead < 0)) {
+                QRCODEC_LOG(LOG_SUMMARY, "Compressed: " << checksummed.size() << " -> " << stream.size() << " bytes ("
+                    << 100.0 * stream.size() / checksummed.size() << "%)");
+            }
+            else {
+                QRCODEC_LOG(LOG_SUMMARY, "Compression: no block shrank, sending the data uncompressed");
+            }
+        }
+        EncoderConfig config;
+        config.frameWidth = frameWidth;
+        config.frameHeight = frameHeight;
+        config.moduleSize = moduleSize;
+        config.rsParity = rsParity;
+        config.bitsPerModule = bitsPerModule;
+        if (plan) {
+            PlanRequest request;
+            request.displayWidth = frameWidth;
+            request.displayHeight = frameHeight;
+            request.minModuleSize = moduleSize;
+            request.rsParity = rsParity;
+            request.bitsPerModule = bitsPerModule;
+            request.fountainOverhead = fountainOverhead;
+            request.fps = fps;
+            CapacityPlan capacity;
+            if (!planCapacity(stream.size(), request, capacity)) {
+                cerr << "Error: Frame resolution too small" << endl;
+                return 1;
+            }
+            config = capacity.config;
+            QRCODEC_LOG(LOG_SUMMARY, "Plan: " << capacity.widthCount << "x" << capacity.heightCount << " modules of "
+                << config.moduleSize << " px, " << config.chunkBytes << " of " << capacity.capacityBytes
+                << " bytes per frame, " << capacity.frames << " frames, " << capacity.seconds << " s at " << fps
+                << " fps (" << capacity.bytesPerSecond / 1024 << " KiB/s)");
+        }
+        bool encoded = encodeToFrames(stream, outputFile, sink, config, fountainOverhead);
+        if (!metricsFile.empty() && !writeMetricsFile(metricsFile, "encode")) {
+            cerr << "Cannot write metrics: " << metricsFile << endl;
+        }
+        return encoded ? 0 : 1;
+    }
+
+    // 单张图像容量有限，直接复制
+    vector<uint8_t> data;
+    {
+        ScopedTimer timer(STAGE_READ);
+        data.assign(input.data(), input.data() + input.size());
+    }
+    encodeToQRCode(data, outputFile, sink, compress);
+    if (!metricsFile.empty() && !writeMetricsFile(metricsFile, "encode")) {
+        cerr << "Cannot write metrics: " << metricsFile << endl;
+    }
     return 0;
 }
\ No newline at end of file
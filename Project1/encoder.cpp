@@ -0,0 +1,429 @@
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+
+#include "codec.h"
+#include "crc32.h"
+#include "frameLayout.h"
+#include "modulation.h"
+#include "lz77.h"
+
+using namespace cv;
+using namespace std;
+
+// 编码器实现：定位标记、校准色块、帧描述区和数据模块的绘制，以及 Encoder 的逐帧编码
+
+// 添加校验码到数据（大端 CRC32，解码器按同样方式验证）
+vector<uint8_t> addChecksum(const vector<uint8_t>& data) {
+    vector<uint8_t> result = data;
+    uint32_t checksum;
+    {
+        ScopedTimer timer(STAGE_CRC);
+        checksum = crc32Update(0, data);
+    }
+
+    // 将32位校验码分成4个字节添加到数据末尾
+    result.push_back((checksum >> 24) & 0xFF);
+    result.push_back((checksum >> 16) & 0xFF);
+    result.push_back((checksum >> 8) & 0xFF);
+    result.push_back(checksum & 0xFF);
+
+    return result;
+}
+
+// 绘制定位标记（在模块网格上绘制，每模块一个字节）
+void drawFinderPattern(Mat& moduleGrid, int centerX, int centerY) {
+    int startX = centerX - FINDER_PATTERN_SIZE / 2;
+    int startY = centerY - FINDER_PATTERN_SIZE / 2;
+
+    // 绘制外黑框
+    for (int y = 0; y < FINDER_PATTERN_SIZE; ++y) {
+        uint8_t* row = moduleGrid.ptr<uint8_t>(startY + y) + startX;
+        for (int x = 0; x < FINDER_PATTERN_SIZE; ++x) {
+            int value = 0; // 黑色
+            if (x >= FINDER_BORDER && x < FINDER_PATTERN_SIZE - FINDER_BORDER &&
+                y >= FINDER_BORDER && y < FINDER_PATTERN_SIZE - FINDER_BORDER) {
+                value = 255; // 内部白色
+            }
+            if (x >= FINDER_BORDER + 1 && x < FINDER_PATTERN_SIZE - FINDER_BORDER - 1 &&
+                y >= FINDER_BORDER + 1 && y < FINDER_PATTERN_SIZE - FINDER_BORDER - 1) {
+                value = 0; // 中心黑色
+            }
+            row[x] = value;
+        }
+    }
+}
+
+// 绘制对齐标记（简化版，同样在模块网格上绘制）
+void drawAlignmentPattern(Mat& moduleGrid, int centerX, int centerY) {
+    int size = 5;
+    int startX = centerX - size / 2;
+    int startY = centerY - size / 2;
+
+    for (int y = 0; y < size; ++y) {
+        uint8_t* row = moduleGrid.ptr<uint8_t>(startY + y) + startX;
+        for (int x = 0; x < size; ++x) {
+            int value = 0; // 黑色
+            if (x >= 1 && x < size - 1 && y >= 1 && y < size - 1) {
+                value = 255; // 白色
+            }
+            if (x >= 2 && x < size - 2 && y >= 2 && y < size - 2) {
+                value = 0; // 中心黑色
+            }
+            row[x] = value;
+        }
+    }
+}
+
+// 把模块网格放大为图像：每个模块行只展开一次扫描线（相同取值的连续模块合并为一次填充），
+// 再整行 memcpy moduleSize 次；网格以外的区域填充白色
+// 单通道图像中网格值即灰度；三通道图像中网格值 0..7 为 8 色符号，255 为白色
+void rasterizeModules(const Mat& moduleGrid, Mat& qrImage, int moduleSize = MODULE_SIZE) {
+    int channels = qrImage.channels();
+    int gridWidth = min(moduleGrid.cols, qrImage.cols / moduleSize);
+    int gridHeight = min(moduleGrid.rows, qrImage.rows / moduleSize);
+    size_t rowBytes = (size_t)qrImage.cols * channels;
+    vector<uint8_t> scanline(rowBytes, 255);
+
+    // 三通道时网格值到 BGR 的查找表
+    uint8_t palette[256][3];
+    if (channels == 3) {
+        memset(palette, 255, sizeof(palette));
+        for (int symbol = 0; symbol < 8; ++symbol) {
+            symbolColor(symbol, palette[symbol]);
+        }
+    }
+
+    for (int my = 0; my < gridHeight; ++my) {
+        const uint8_t* modules = moduleGrid.ptr<uint8_t>(my);
+        int x = 0;
+        while (x < gridWidth) {
+            int runEnd = x + 1;
+            while (runEnd < gridWidth && modules[runEnd] == modules[x]) {
+                runEnd++;
+            }
+            uint8_t* span = &scanline[(size_t)x * moduleSize * channels];
+            size_t spanBytes = (size_t)(runEnd - x) * moduleSize * channels;
+            if (channels == 1) {
+                memset(span, modules[x], spanBytes);
+            }
+            else {
+                // 先写一个像素，再按倍增方式复制
+                memcpy(span, palette[modules[x]], 3);
+                for (size_t filled = 3; filled < spanBytes; filled *= 2) {
+                    memcpy(span + filled, span, min(filled, spanBytes - filled));
+                }
+            }
+            x = runEnd;
+        }
+
+        for (int py = 0; py < moduleSize; ++py) {
+            memcpy(qrImage.ptr<uint8_t>(my * moduleSize + py), scanline.data(), rowBytes);
+        }
+    }
+
+    for (int y = gridHeight * moduleSize; y < qrImage.rows; ++y) {
+        memset(qrImage.ptr<uint8_t>(y), 255, rowBytes);
+    }
+}
+
+// 模块网格中符号的取值：黑白与灰度模式为灰度，8 色模式为符号本身（光栅化时查表）
+inline uint8_t symbolGridValue(int symbol, int bitsPerModule) {
+    return (bitsPerModule == 3) ? (uint8_t)symbol : symbolGray(symbol, bitsPerModule);
+}
+
+// 在已分配好的图像上绘制定位标记和数据模块，返回实际写入的比特数
+// bitsPerModule > 1 时每个模块承载多个比特（见 modulation.h），并绘制校准色块；图像通道数需与之匹配
+// descriptor 不为空时绘制帧描述区（见 frameDescriptor.h），数据模块让出该区域；其标志含定时线时绘制定时线
+// moduleGrid 为模块网格工作区，尺寸不符时重新分配
+int drawQRCode(Mat& qrImage, Mat& moduleGrid, const BitStream& bits, int widthCount, int heightCount,
+    int bitsPerModule = 1, int moduleSize = MODULE_SIZE, const FrameDescriptor* descriptor = nullptr) {
+    int qrWidthInModules = widthCount + 2 * BORDER;
+    int qrHeightInModules = heightCount + 2 * BORDER;
+
+    // 先在模块网格上绘制（白色背景），最后统一光栅化
+    moduleGrid.create(qrHeightInModules, qrWidthInModules, CV_8UC1);
+    moduleGrid.setTo(Scalar(255));
+
+    // 绘制三个定位标记（左上、右上、左下）
+    drawFinderPattern(moduleGrid, BORDER + FINDER_PATTERN_SIZE / 2,
+        BORDER + FINDER_PATTERN_SIZE / 2);
+    drawFinderPattern(moduleGrid,
+        qrWidthInModules - BORDER - FINDER_PATTERN_SIZE / 2 - 1,
+        BORDER + FINDER_PATTERN_SIZE / 2);
+    drawFinderPattern(moduleGrid,
+        BORDER + FINDER_PATTERN_SIZE / 2,
+        qrHeightInModules - BORDER - FINDER_PATTERN_SIZE / 2 - 1);
+
+    // 绘制对齐标记（右下角）
+    if (widthCount > 15 && heightCount > 15) {
+        drawAlignmentPattern(
+            moduleGrid,
+            BORDER + widthCount - 4,
+            BORDER + heightCount - 4
+        );
+    }
+
+    const FrameLayout& layout = getFrameLayout(widthCount, heightCount, calibrationLevels(bitsPerModule),
+        descriptor != nullptr, descriptor && descriptor->timing());
+
+    // 绘制帧描述区（恒为黑白）
+    if (descriptor) {
+        vector<uint8_t> descriptorBytes = encodeFrameDescriptor(*descriptor);
+        for (int i = 0; i < DESCRIPTOR_COLUMNS; ++i) {
+            for (int bit = 0; bit < DESCRIPTOR_ROWS; ++bit) {
+                ModuleCoord m = descriptorModule(i, bit);
+                bool dark = (descriptorBytes[i] >> (7 - bit)) & 1;
+                // 网格值 0 / 255 在单通道和三通道图像中都是黑 / 白
+                moduleGrid.ptr<uint8_t>(m.y + BORDER)[m.x + BORDER] = dark ? 0 : 255;
+            }
+        }
+    }
+
+    // 绘制定时线（恒为黑白，交点两者一致）
+    for (int y : layout.timingRows) {
+        for (int x = 0; x < widthCount; ++x) {
+            if (layout.isTiming(x, y)) {
+                moduleGrid.ptr<uint8_t>(y + BORDER)[x + BORDER] = timingModuleDark(x, y, heightCount) ? 0 : 255;
+            }
+        }
+    }
+    for (int x : layout.timingColumns) {
+        for (int y = 0; y < heightCount; ++y) {
+            if (layout.isTiming(x, y)) {
+                moduleGrid.ptr<uint8_t>(y + BORDER)[x + BORDER] = timingModuleDark(x, y, heightCount) ? 0 : 255;
+            }
+        }
+    }
+
+    // 绘制校准色块
+    for (size_t i = 0; i < layout.calibrationModules.size(); ++i) {
+        const ModuleCoord& m = layout.calibrationModules[i];
+        moduleGrid.ptr<uint8_t>(m.y + BORDER)[m.x + BORDER] =
+            symbolGridValue((int)(i / CALIBRATION_REPEAT), bitsPerModule);
+    }
+
+    // 绘制数据模块（按缓存的布局直接遍历，定位标记区域已排除）
+    int idx = 0;
+    if (bitsPerModule == 1) {
+        idx = (int)min(bits.size(), layout.dataModuleCount());
+        for (int i = 0; i < idx; ++i) {
+            const ModuleCoord& m = layout.dataModules[i];
+            moduleGrid.ptr<uint8_t>(m.y + BORDER)[m.x + BORDER] = bits[i] ? 0 : 255; // 黑 = 1, 白 = 0
+        }
+    }
+    else {
+        // 每个模块取 bitsPerModule 比特作为一个符号（高位在前），末尾不足的比特补 0
+        size_t modules = min((bits.size() + bitsPerModule - 1) / bitsPerModule, layout.dataModuleCount());
+        for (size_t i = 0; i < modules; ++i) {
+            size_t pos = i * bitsPerModule;
+            int available = (int)min((size_t)bitsPerModule, bits.size() - pos);
+            int symbol = (int)(bits.readBits(pos, available) << (bitsPerModule - available));
+            const ModuleCoord& m = layout.dataModules[i];
+            moduleGrid.ptr<uint8_t>(m.y + BORDER)[m.x + BORDER] = symbolGridValue(symbol, bitsPerModule);
+        }
+        idx = (int)min(bits.size(), modules * bitsPerModule);
+    }
+
+    rasterizeModules(moduleGrid, qrImage, moduleSize);
+    return idx;
+}
+
+// 单张图像编码
+void encodeSingleImage(const vector<uint8_t>& data, Mat& image, bool compress) {
+    // 压缩（有块变短时才改用压缩流），再添加校验码
+    vector<uint8_t> packed;
+    if (compress) {
+        ScopedTimer timer(STAGE_COMPRESS);
+        size_t compressedBlocks = 0;
+        packed = lzCompressBuffer(data, &compressedBlocks);
+        if (compressedBlocks == 0) {
+            packed.clear();
+            compress = false;
+        }
+        else {
+            QRCODEC_LOG(LOG_SUMMARY, "Compressed: " << data.size() << " -> " << packed.size() << " bytes");
+        }
+    }
+    vector<uint8_t> dataWithChecksum = addChecksum(compress ? packed : data);
+
+    BitStream bits;
+    {
+        ScopedTimer timer(STAGE_PACK);
+        packWithParity(dataWithChecksum.data(), dataWithChecksum.size(), bits);
+    }
+
+    const float desired_aspect_ratio = 16.0 / 9.0;
+
+    // 高度模块数量（向上取整，避免不足）
+    int heightCount = ceil(sqrt(bits.size() / desired_aspect_ratio));
+
+    // 宽度模块数量
+    int widthCount = ceil(heightCount * desired_aspect_ratio);
+
+    // 确保有足够空间放置定位标记和帧描述区
+    heightCount = max(heightCount, 2 * (FINDER_PATTERN_SIZE + FINDER_BORDER));//height的更小
+    widthCount = max(widthCount, DESCRIPTOR_MIN_WIDTH);
+
+    // 扣除保留区域（宽网格含定时线）后放不下时逐行加高
+    while (getFrameLayout(widthCount, heightCount, 0, true, timingPatternsUsed(widthCount, heightCount))
+        .dataModuleCount() < bits.size()) {
+        heightCount++;
+        widthCount = max((int)ceil(heightCount * desired_aspect_ratio), DESCRIPTOR_MIN_WIDTH);
+    }
+
+    // 帧描述区写明数据长度，解码器读到数据末尾即止
+    FrameDescriptor descriptor;
+    descriptor.widthCount = widthCount;
+    descriptor.heightCount = heightCount;
+    descriptor.moduleSize = MODULE_SIZE;
+    descriptor.payloadBytes = (uint32_t)dataWithChecksum.size();
+    descriptor.flags = (compress ? DESCRIPTOR_FLAG_COMPRESSED : 0) |
+        (timingPatternsUsed(widthCount, heightCount) ? DESCRIPTOR_FLAG_TIMING : 0);
+
+    // 计算实际二维码大小（包含边框）
+    int qrWidthInModules = widthCount + 2 * BORDER;
+    int qrHeightInModules = heightCount + 2 * BORDER;
+
+    image.create(qrHeightInModules * MODULE_SIZE, qrWidthInModules * MODULE_SIZE, CV_8UC1);
+    Mat moduleGrid;
+    int idx;
+    {
+        ScopedTimer timer(STAGE_RASTER);
+        idx = drawQRCode(image, moduleGrid, bits, widthCount, heightCount, 1, MODULE_SIZE, &descriptor);
+    }
+
+    QRCODEC_LOG(LOG_SUMMARY, "Data size: " << data.size() << " bytes");
+    QRCODEC_LOG(LOG_SUMMARY, "With checksum: " << dataWithChecksum.size() << " bytes");
+    QRCODEC_LOG(LOG_SUMMARY, "QR Code size: " << widthCount << "x" << heightCount << " y");
+
+    QRCODEC_LOG(LOG_SUMMARY, "Total bits (with parity): " << bits.size());
+    QRCODEC_LOG(LOG_SUMMARY, "Bits actually written: " << idx);
+}
+
+// 按分辨率与模块大小求网格尺寸和每帧纠错前可容纳的字节数（含帧头，宽网格扣除定时线）；
+// 放不下定位标记、校准色块、帧描述区或帧头时返回 0
+size_t frameCapacity(const EncoderConfig& config, int& widthCount, int& heightCount, size_t& dataBits) {
+    widthCount = config.frameWidth / config.moduleSize - 2 * BORDER;
+    heightCount = config.frameHeight / config.moduleSize - 2 * BORDER;
+    int calibrationWidth = calibrationLevels(config.bitsPerModule) * CALIBRATION_REPEAT;
+    if (widthCount < max(2 * (FINDER_PATTERN_SIZE + FINDER_BORDER) + calibrationWidth, DESCRIPTOR_MIN_WIDTH) ||
+        heightCount < 2 * (FINDER_PATTERN_SIZE + FINDER_BORDER)) {
+        return 0;
+    }
+
+    dataBits = getFrameLayout(widthCount, heightCount, calibrationLevels(config.bitsPerModule), true,
+        timingPatternsUsed(widthCount, heightCount)).dataModuleCount() * config.bitsPerModule;
+    size_t frameBytes = (config.rsParity > 0) ? rsFrameCapacity(dataBits / 8, config.rsParity) : dataBits / 9;
+    return (frameBytes > (size_t)FRAME_HEADER_SIZE) ? frameBytes : 0;
+}
+
+bool planCapacity(uint64_t streamBytes, const PlanRequest& request, CapacityPlan& plan) {
+    EncoderConfig config;
+    config.frameWidth = request.displayWidth;
+    config.frameHeight = request.displayHeight;
+    config.rsParity = request.rsParity;
+    config.bitsPerModule = request.bitsPerModule;
+
+    bool found = false;
+    for (int moduleSize = max(request.minModuleSize, 1); moduleSize <= 255; ++moduleSize) {
+        config.moduleSize = moduleSize;
+        int widthCount, heightCount;
+        size_t dataBits;
+        size_t frameBytes = frameCapacity(config, widthCount, heightCount, dataBits);
+        if (frameBytes == 0) {
+            break;   // 模块再大网格只会更小
+        }
+        size_t capacity = frameBytes - FRAME_HEADER_SIZE;
+        uint64_t sourceFrames = max<uint64_t>((streamBytes + capacity - 1) / capacity, 1);
+        uint64_t frames = sourceFrames;
+        if (request.fountainOverhead >= 0) {
+            frames += (uint64_t)ceil(sourceFrames * request.fountainOverhead / 100.0);
+        }
+        // 容量随模块增大并不单调（网格窄于 TIMING_MIN_WIDTH 时不再有定时线，每帧反而可能多装数据），
+        // 所以逐个比较所有模块大小，帧数相同时取更大的模块
+        if (frames > UINT32_MAX || (found && frames > plan.frames)) {
+            continue;
+        }
+
+        plan.config = config;
+        plan.config.chunkBytes = (size_t)((streamBytes + sourceFrames - 1) / sourceFrames);
+        plan.widthCount = widthCount;
+        plan.heightCount = heightCount;
+        plan.capacityBytes = capacity;
+        plan.frames = (uint32_t)frames;
+        plan.seconds = frames / request.fps;
+        plan.bytesPerSecond = streamBytes / plan.seconds;
+        found = true;
+    }
+    return found;
+}
+
+bool Encoder::configure(const EncoderConfig& config) {
+    int widthCount, heightCount;
+    size_t dataBits;
+    size_t frameBytes = frameCapacity(config, widthCount, heightCount, dataBits);
+    if (frameBytes == 0) {
+        return false;
+    }
+    size_t rawBytes = dataBits / 8;
+
+    cfg = config;
+    gridWidth = widthCount;
+    gridHeight = heightCount;
+    chunkSize = frameBytes - FRAME_HEADER_SIZE;
+    if (config.chunkBytes > 0) {
+        chunkSize = min(chunkSize, config.chunkBytes);
+    }
+    rs.reset(config.rsParity > 0 ? new RsFrameEncoder(config.rsParity) : nullptr);
+    frame.reserve(frameBytes);
+    encoded.reserve(rawBytes);
+    bits.assign(dataBits);
+    moduleGrid.create(heightCount + 2 * BORDER, widthCount + 2 * BORDER, CV_8UC1);
+
+    descriptor = FrameDescriptor();
+    descriptor.widthCount = widthCount;
+    descriptor.heightCount = heightCount;
+    descriptor.moduleSize = config.moduleSize;
+    descriptor.bitsPerModule = config.bitsPerModule;
+    descriptor.rsParity = config.rsParity;
+    return true;
+}
+
+int Encoder::frameType() const {
+    return modulationChannels(cfg.bitsPerModule) == 3 ? CV_8UC3 : CV_8UC1;
+}
+
+// 每帧带帧描述区（见 frameDescriptor.h），写明网格尺寸、模块大小、调制与纠错参数、
+// 本帧数据区长度和帧序号；数据区只写到本帧数据的纠错码末尾
+void Encoder::encodeFrame(const FrameHeader& header, const uint8_t* data, Mat& image) {
+    size_t length = header.fountain ? chunkSize : min((size_t)header.length, chunkSize);
+    frame.resize(FRAME_HEADER_SIZE + length);
+    writeFrameHeader(frame.data(), header);
+    memcpy(frame.data() + FRAME_HEADER_SIZE, data, length);
+
+    descriptor.flags = (header.fountain ? DESCRIPTOR_FLAG_FOUNTAIN : 0) | (header.compressed ? DESCRIPTOR_FLAG_COMPRESSED : 0) |
+        (timingPatternsUsed(gridWidth, gridHeight) ? DESCRIPTOR_FLAG_TIMING : 0);
+    descriptor.payloadBytes = (uint32_t)frame.size();
+    descriptor.seq = header.seq;
+    if (rs) {
+        {
+            ScopedTimer timer(STAGE_FEC);
+            rs->encode(frame.data(), frame.size(), rsEncodedSize(frame.size(), cfg.rsParity), encoded);
+        }
+        ScopedTimer timer(STAGE_PACK);
+        packBytes(encoded.data(), encoded.size(), bits);
+    }
+    else {
+        ScopedTimer timer(STAGE_PACK);
+        packWithParity(frame.data(), frame.size(), bits);
+    }
+
+    ScopedTimer timer(STAGE_RASTER);
+    image.create(cfg.frameHeight, cfg.frameWidth, frameType());
+    drawQRCode(image, moduleGrid, bits, gridWidth, gridHeight, cfg.bitsPerModule, cfg.moduleSize, &descriptor);
+    metrics().count(COUNTER_FRAMES);
+}
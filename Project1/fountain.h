@@ -0,0 +1,359 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <unordered_set>
+#include <vector>
+
+// LT 喷泉码（无速率编码，编码器与解码器共用）：数据流按 symbolSize 切成 k 个源符号（末尾补 0），
+// 编码符号 id < k 时就是第 id 个源符号（系统符号，无丢帧时收到 k 帧即可恢复），
+// id >= k 时为若干源符号的异或，度数取自鲁棒孤波分布（下限见 FOUNTAIN_MIN_REPAIR_DEGREE），邻居由 id 决定的伪随机序列选出，
+// 两端各自按 id 重新生成，无需传输。接收端以任意顺序收集略多于 k 个符号后用剥离译码恢复全部源符号
+
+// 鲁棒孤波分布参数
+const double FOUNTAIN_C = 0.1;
+const double FOUNTAIN_DELTA = 0.05;
+
+// 冗余符号的最小度数（不超过 k / 2）：系统符号已覆盖大部分源符号，低度数的冗余符号多半只含已收到的
+// 源符号而没有用处；度数足够大时每个冗余符号都覆盖几个丢失的源符号，消元只需略多于丢失数的冗余符号
+const uint32_t FOUNTAIN_MIN_REPAIR_DEGREE = 32;
+
+// 伪随机数（splitmix64）
+inline uint64_t fountainRandom(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// 度数的累积分布（cdf[d - 1] = P(度数 <= d)）
+inline std::vector<double> robustSolitonCdf(uint32_t k) {
+    if (k == 0) {
+        return std::vector<double>();
+    }
+    std::vector<double> weight(k, 0.0);
+    double s = FOUNTAIN_C * std::log(k / FOUNTAIN_DELTA) * std::sqrt((double)k);
+    int spike = (s > 0) ? (int)std::floor(k / s) : (int)k;
+    spike = std::max(1, std::min(spike, (int)k));
+    for (uint32_t d = 1; d <= k; ++d) {
+        double rho = (d == 1) ? 1.0 / k : 1.0 / ((double)d * (d - 1));
+        double tau = 0;
+        if ((int)d < spike) {
+            tau = s / ((double)k * d);
+        }
+        else if ((int)d == spike) {
+            tau = s * std::log(s / FOUNTAIN_DELTA) / k;
+        }
+        weight[d - 1] = rho + std::max(tau, 0.0);
+    }
+
+    std::vector<double> cdf(k);
+    double sum = 0;
+    for (uint32_t d = 0; d < k; ++d) {
+        sum += weight[d];
+        cdf[d] = sum;
+    }
+    for (double& value : cdf) {
+        value /= sum;
+    }
+    return cdf;
+}
+
+// 编码符号 id 的邻居（源符号下标，互不相同）
+inline void fountainNeighbors(uint32_t id, uint32_t k, const std::vector<double>& cdf,
+    std::vector<uint32_t>& neighbors) {
+    neighbors.clear();
+    if (id < k) {
+        neighbors.push_back(id);
+        return;
+    }
+
+    uint64_t state = ((uint64_t)k << 32) ^ id;
+    double u = (fountainRandom(state) >> 11) * (1.0 / 9007199254740992.0);
+    uint32_t degree = (uint32_t)(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin()) + 1;
+    degree = std::max(degree, std::min(FOUNTAIN_MIN_REPAIR_DEGREE, std::max(k / 2, 1u)));
+    degree = std::min(degree, k);
+
+    // 度数通常很小，逐个抽取并排除重复
+    while (neighbors.size() < degree) {
+        uint32_t index = (uint32_t)(fountainRandom(state) % k);
+        if (std::find(neighbors.begin(), neighbors.end(), index) == neighbors.end()) {
+            neighbors.push_back(index);
+        }
+    }
+}
+
+inline void xorBytes(uint8_t* dst, const uint8_t* src, size_t length) {
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t a, b;
+        memcpy(&a, dst + i, 8);
+        memcpy(&b, src + i, 8);
+        a ^= b;
+        memcpy(dst + i, &a, 8);
+    }
+    for (; i < length; ++i) {
+        dst[i] ^= src[i];
+    }
+}
+
+inline uint32_t fountainSourceSymbols(size_t length, size_t symbolSize) {
+    return (uint32_t)((length + symbolSize - 1) / symbolSize);
+}
+
+// 编码器不复制数据流：源符号由 readSource(offset, length, out) 按需读取（可直接读映射的文件）
+class FountainEncoder {
+public:
+    typedef std::function<void(size_t offset, size_t length, uint8_t* out)> SourceReader;
+
+    FountainEncoder(size_t length, size_t symbolSize, SourceReader readSource)
+        : length(length), symbolSize(symbolSize), k(fountainSourceSymbols(length, symbolSize)),
+        cdf(robustSolitonCdf(k)), readSource(readSource), scratch(symbolSize) {}
+
+    uint32_t sourceSymbols() const {
+        return k;
+    }
+
+    // 生成编码符号 id（symbolSize 字节）
+    void encodeSymbol(uint32_t id, uint8_t* out) {
+        fountainNeighbors(id, k, cdf, neighbors);
+        readSymbol(neighbors[0], out);
+        for (size_t i = 1; i < neighbors.size(); ++i) {
+            readSymbol(neighbors[i], scratch.data());
+            xorBytes(out, scratch.data(), symbolSize);
+        }
+    }
+
+private:
+    // 第 index 个源符号，数据流末尾不足的部分补 0
+    void readSymbol(uint32_t index, uint8_t* out) {
+        size_t offset = (size_t)index * symbolSize;
+        size_t available = std::min(symbolSize, length - offset);
+        readSource(offset, available, out);
+        memset(out + available, 0, symbolSize - available);
+    }
+
+    size_t length;
+    size_t symbolSize;
+    uint32_t k;
+    std::vector<double> cdf;
+    SourceReader readSource;
+    std::vector<uint8_t> scratch;
+    std::vector<uint32_t> neighbors;
+};
+
+// 剥离译码：收到的编码符号先消去已知的源符号，剩一个未知邻居时即解出该源符号，
+// 再把它从所有引用它的待定符号中消去，依次传播。k 较小时剥离常在只剩少数源符号时停滞，
+// 此时待定符号数不少于未知源符号数就对剩余部分做 GF(2) 高斯消元（类似 Raptor 的失活译码）
+class FountainDecoder {
+public:
+    FountainDecoder(uint32_t k, size_t symbolSize, size_t length)
+        : k(k), symbolSize(symbolSize), length(length), cdf(robustSolitonCdf(k)),
+        source((size_t)k * symbolSize, 0), known(k, 0), waiting(k) {}
+
+    uint32_t sourceSymbols() const {
+        return k;
+    }
+
+    size_t symbolBytes() const {
+        return symbolSize;
+    }
+
+    size_t streamLength() const {
+        return length;
+    }
+
+    size_t receivedSymbols() const {
+        return received.size();
+    }
+
+    uint32_t recoveredSymbols() const {
+        return recovered;
+    }
+
+    bool complete() const {
+        return recovered == k;
+    }
+
+    bool hasSymbol(uint32_t id) const {
+        return received.count(id) != 0;
+    }
+
+    // 收下编码符号 id；重复的符号返回 false
+    bool addSymbol(uint32_t id, const uint8_t* data) {
+        if (!received.insert(id).second) {
+            return false;
+        }
+        if (complete()) {
+            return true;
+        }
+
+        fountainNeighbors(id, k, cdf, neighbors);
+        PendingSymbol symbol;
+        symbol.data.assign(data, data + symbolSize);
+        for (uint32_t index : neighbors) {
+            if (known[index]) {
+                xorBytes(symbol.data.data(), &source[(size_t)index * symbolSize], symbolSize);
+            }
+            else {
+                symbol.unknown.push_back(index);
+            }
+        }
+
+        if (symbol.unknown.size() == 1) {
+            resolve(symbol.unknown[0], symbol.data.data());
+        }
+        else if (symbol.unknown.size() > 1) {
+            uint32_t slot = (uint32_t)pending.size();
+            for (uint32_t index : symbol.unknown) {
+                waiting[index].push_back(slot);
+            }
+            pending.push_back(std::move(symbol));
+            activePending++;
+        }
+
+        if (!complete() && activePending >= k - recovered) {
+            eliminate();
+        }
+        return true;
+    }
+
+    // 恢复的数据流，共 streamLength() 字节（complete() 之后有效）
+    const uint8_t* data() const {
+        return source.data();
+    }
+
+private:
+    struct PendingSymbol {
+        std::vector<uint32_t> unknown;
+        std::vector<uint8_t> data;
+    };
+
+    void resolve(uint32_t index, const uint8_t* data) {
+        memcpy(&source[(size_t)index * symbolSize], data, symbolSize);
+        known[index] = 1;
+        recovered++;
+        std::vector<uint32_t> ripple(1, index);
+
+        while (!ripple.empty()) {
+            uint32_t solved = ripple.back();
+            ripple.pop_back();
+            const uint8_t* solvedData = &source[(size_t)solved * symbolSize];
+            for (uint32_t slot : waiting[solved]) {
+                PendingSymbol& symbol = pending[slot];
+                auto it = std::find(symbol.unknown.begin(), symbol.unknown.end(), solved);
+                if (it == symbol.unknown.end()) {
+                    continue;
+                }
+                xorBytes(symbol.data.data(), solvedData, symbolSize);
+                symbol.unknown.erase(it);
+                if (symbol.unknown.size() == 1 && !known[symbol.unknown[0]]) {
+                    uint32_t next = symbol.unknown[0];
+                    memcpy(&source[(size_t)next * symbolSize], symbol.data.data(), symbolSize);
+                    known[next] = 1;
+                    recovered++;
+                    ripple.push_back(next);
+                }
+                if (symbol.unknown.size() <= 1) {
+                    activePending--;
+                    symbol.unknown.clear();
+                    std::vector<uint8_t>().swap(symbol.data);
+                }
+            }
+            std::vector<uint32_t>().swap(waiting[solved]);
+        }
+    }
+
+    // 对未知源符号列方程组做高斯-约当消元：先只消元系数矩阵检查是否满秩（不满秩时什么也不改），
+    // 满秩时再带上符号数据重做一遍，解出全部剩余源符号
+    void eliminate() {
+        std::vector<uint32_t> columns;
+        std::vector<int> columnOf(k, -1);
+        for (uint32_t index = 0; index < k; ++index) {
+            if (!known[index]) {
+                columnOf[index] = (int)columns.size();
+                columns.push_back(index);
+            }
+        }
+        std::vector<uint32_t> rows;
+        for (uint32_t slot = 0; slot < pending.size(); ++slot) {
+            if (pending[slot].unknown.size() >= 2) {
+                rows.push_back(slot);
+            }
+        }
+
+        size_t unknowns = columns.size();
+        size_t words = (unknowns + 63) / 64;
+        std::vector<uint64_t> matrix(rows.size() * words, 0);
+        auto buildMatrix = [&]() {
+            std::fill(matrix.begin(), matrix.end(), 0);
+            for (size_t r = 0; r < rows.size(); ++r) {
+                for (uint32_t index : pending[rows[r]].unknown) {
+                    int c = columnOf[index];
+                    matrix[r * words + c / 64] |= 1ull << (c % 64);
+                }
+            }
+        };
+        auto reduce = [&](bool withData) {
+            for (size_t c = 0; c < unknowns; ++c) {
+                size_t w = c / 64;
+                uint64_t bit = 1ull << (c % 64);
+                size_t pivot = c;
+                while (pivot < rows.size() && !(matrix[pivot * words + w] & bit)) {
+                    ++pivot;
+                }
+                if (pivot == rows.size()) {
+                    return false;
+                }
+                if (pivot != c) {
+                    std::swap_ranges(&matrix[pivot * words], &matrix[pivot * words] + words, &matrix[c * words]);
+                    std::swap(rows[pivot], rows[c]);
+                }
+                for (size_t r = 0; r < rows.size(); ++r) {
+                    if (r != c && (matrix[r * words + w] & bit)) {
+                        // 主元行在第 c 列之前已全部消为 0，从第 w 个字开始即可
+                        for (size_t i = w; i < words; ++i) {
+                            matrix[r * words + i] ^= matrix[c * words + i];
+                        }
+                        if (withData) {
+                            xorBytes(pending[rows[r]].data.data(), pending[rows[c]].data.data(), symbolSize);
+                        }
+                    }
+                }
+            }
+            return true;
+        };
+
+        buildMatrix();
+        if (!reduce(false)) {
+            return;
+        }
+        buildMatrix();
+        reduce(true);
+
+        for (size_t c = 0; c < unknowns; ++c) {
+            memcpy(&source[(size_t)columns[c] * symbolSize], pending[rows[c]].data.data(), symbolSize);
+            known[columns[c]] = 1;
+        }
+        recovered = k;
+        pending.clear();
+        activePending = 0;
+        std::vector<std::vector<uint32_t>>(k).swap(waiting);
+    }
+
+    uint32_t k;
+    size_t symbolSize;
+    size_t length;
+    std::vector<double> cdf;
+    std::vector<uint8_t> source;
+    std::vector<uint8_t> known;
+    std::vector<std::vector<uint32_t>> waiting;   // 每个源符号被哪些待定符号引用
+    std::vector<PendingSymbol> pending;
+    std::unordered_set<uint32_t> received;
+    std::vector<uint32_t> neighbors;
+    uint32_t recovered = 0;
+    uint32_t activePending = 0;   // 仍有两个以上未知邻居的待定符号数
+};
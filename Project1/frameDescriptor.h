@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "frameLayout.h"
+#include "reedSolomon.h"
+
+// 帧描述区（流式帧，编码器与解码器共用）：每帧在固定位置写出解码所需的全部参数，
+// 解码器逐帧读出后按其采样、纠错，无需与编码器约定网格尺寸、模块大小、调制方式和纠错参数。
+// 位置：左上定位标记右侧，第 [0, DESCRIPTOR_ROWS) 行、第 [DESCRIPTOR_LEFT, DESCRIPTOR_LEFT + DESCRIPTOR_COLUMNS) 列；
+// 恒为黑白调制，每列 8 个模块为一个字节（上为高位），整体为缩短的 RS(40, 20) 码字，可纠正 10 个错误字节
+const int DESCRIPTOR_VERSION = 2;   // 版本 2 起有压缩、定时线标志，见 descriptorVersionFor
+const int DESCRIPTOR_DATA_BYTES = 20;
+const int DESCRIPTOR_PARITY_BYTES = 20;
+const int DESCRIPTOR_ROWS = DESCRIPTOR_AREA_HEIGHT;
+const int DESCRIPTOR_COLUMNS = DESCRIPTOR_AREA_WIDTH;
+const int DESCRIPTOR_LEFT = DESCRIPTOR_AREA_LEFT;
+const uint8_t DESCRIPTOR_MAGIC[2] = { 'Q', 'D' };
+static_assert(DESCRIPTOR_DATA_BYTES + DESCRIPTOR_PARITY_BYTES == DESCRIPTOR_COLUMNS, "descriptor area size mismatch");
+static_assert(DESCRIPTOR_ROWS == 8, "one byte per descriptor column");
+
+// 帧描述区所需的最小网格宽度（描述区右侧还要留出右上定位标记）
+const int DESCRIPTOR_MIN_WIDTH = DESCRIPTOR_LEFT + DESCRIPTOR_COLUMNS + FINDER_PATTERN_SIZE + FINDER_BORDER;
+
+const uint8_t DESCRIPTOR_FLAG_FOUNTAIN = 1;    // 数据区为喷泉码符号（见 fountain.h）
+const uint8_t DESCRIPTOR_FLAG_COMPRESSED = 2;  // 数据流为压缩流（见 lz77.h），接收端解压后验证校验码
+const uint8_t DESCRIPTOR_FLAG_TIMING = 4;      // 网格带定时线（见 frameLayout.h），数据模块让出定时线
+
+// 各版本认识的标志。标志都改变帧的读法（定时线不是数据、压缩流不是文件），解码器拒绝不认识的标志位；
+// 只带版本 1 标志的帧仍写版本 1，旧解码器照常读取，带新标志的帧写版本 2，旧解码器按版本不符拒绝而不是读错
+const uint8_t DESCRIPTOR_FLAGS_V1 = DESCRIPTOR_FLAG_FOUNTAIN;
+const uint8_t DESCRIPTOR_FLAGS_V2 = DESCRIPTOR_FLAGS_V1 | DESCRIPTOR_FLAG_COMPRESSED | DESCRIPTOR_FLAG_TIMING;
+
+// 能表示这些标志的最低版本
+inline int descriptorVersionFor(uint8_t flags) {
+    return (flags & ~DESCRIPTOR_FLAGS_V1) ? 2 : 1;
+}
+
+// 字节布局：魔数(2) + 版本(1) + 网格宽(2) + 网格高(2) + 模块像素(1) + 每模块比特数(1) + RS 校验字节数(1)
+//   + 标志(1) + 数据区字节数(4) + 帧序号(4) + 保留(1)，多字节字段为大端
+struct FrameDescriptor {
+    int version = DESCRIPTOR_VERSION;   // 解码时为帧中的版本；编码时按标志写出所需的最低版本
+    int widthCount = 0;
+    int heightCount = 0;
+    int moduleSize = 0;
+    int bitsPerModule = 1;
+    int rsParity = 0;            // 0 = 每字节 9bit 奇偶校验
+    uint8_t flags = 0;
+    uint32_t payloadBytes = 0;   // 数据区纠错前的字节数（帧头 + 数据块），解码器采样到此为止
+    uint32_t seq = 0;            // 帧序号（喷泉码帧为编码符号序号）
+
+    bool fountain() const {
+        return (flags & DESCRIPTOR_FLAG_FOUNTAIN) != 0;
+    }
+
+    bool compressed() const {
+        return (flags & DESCRIPTOR_FLAG_COMPRESSED) != 0;
+    }
+
+    bool timing() const {
+        return (flags & DESCRIPTOR_FLAG_TIMING) != 0;
+    }
+};
+
+// 数据区纠错编码后占用的比特数
+inline size_t descriptorPayloadBits(const FrameDescriptor& descriptor) {
+    if (descriptor.rsParity > 0) {
+        return rsEncodedSize(descriptor.payloadBytes, descriptor.rsParity) * 8;
+    }
+    return (size_t)descriptor.payloadBytes * 9;
+}
+
+// 描述区第 i 个字节的第 bit 位（0 = 最高位）所在模块
+inline ModuleCoord descriptorModule(int i, int bit) {
+    return { (uint16_t)(DESCRIPTOR_LEFT + i), (uint16_t)bit };
+}
+
+// 编码为 DESCRIPTOR_COLUMNS 字节的码字
+inline std::vector<uint8_t> encodeFrameDescriptor(const FrameDescriptor& descriptor) {
+    std::vector<uint8_t> bytes(DESCRIPTOR_COLUMNS, 0);
+    uint8_t* p = bytes.data();
+    *p++ = DESCRIPTOR_MAGIC[0];
+    *p++ = DESCRIPTOR_MAGIC[1];
+    *p++ = (uint8_t)descriptorVersionFor(descriptor.flags);
+    *p++ = (uint8_t)(descriptor.widthCount >> 8);
+    *p++ = (uint8_t)descriptor.widthCount;
+    *p++ = (uint8_t)(descriptor.heightCount >> 8);
+    *p++ = (uint8_t)descriptor.heightCount;
+    *p++ = (uint8_t)descriptor.moduleSize;
+    *p++ = (uint8_t)descriptor.bitsPerModule;
+    *p++ = (uint8_t)descriptor.rsParity;
+    *p++ = descriptor.flags;
+    for (uint32_t field : { descriptor.payloadBytes, descriptor.seq }) {
+        *p++ = (uint8_t)(field >> 24);
+        *p++ = (uint8_t)(field >> 16);
+        *p++ = (uint8_t)(field >> 8);
+        *p++ = (uint8_t)field;
+    }
+
+    ReedSolomon rs(DESCRIPTOR_PARITY_BYTES);
+    rs.encode(bytes.data(), DESCRIPTOR_DATA_BYTES, bytes.data() + DESCRIPTOR_DATA_BYTES);
+    return bytes;
+}
+
+// 纠错后解析码字（就地纠正）；无法纠正、魔数不符、版本不支持或带该版本不认识的标志位时返回 false
+inline bool decodeFrameDescriptor(std::vector<uint8_t>& bytes, FrameDescriptor& descriptor) {
+    ReedSolomon rs(DESCRIPTOR_PARITY_BYTES);
+    if (bytes.size() != DESCRIPTOR_COLUMNS || rs.decode(bytes.data(), DESCRIPTOR_COLUMNS) < 0) {
+        return false;
+    }
+    const uint8_t* p = bytes.data();
+    if (p[0] != DESCRIPTOR_MAGIC[0] || p[1] != DESCRIPTOR_MAGIC[1] || p[2] < 1 || p[2] > DESCRIPTOR_VERSION) {
+        return false;
+    }
+    uint8_t knownFlags = (p[2] == 1) ? DESCRIPTOR_FLAGS_V1 : DESCRIPTOR_FLAGS_V2;
+    if (p[10] & ~knownFlags) {
+        return false;
+    }
+    descriptor.version = p[2];
+    descriptor.widthCount = (p[3] << 8) | p[4];
+    descriptor.heightCount = (p[5] << 8) | p[6];
+    descriptor.moduleSize = p[7];
+    descriptor.bitsPerModule = p[8];
+    descriptor.rsParity = p[9];
+    descriptor.flags = p[10];
+    descriptor.payloadBytes = (uint32_t(p[11]) << 24) | (uint32_t(p[12]) << 16) | (uint32_t(p[13]) << 8) | p[14];
+    descriptor.seq = (uint32_t(p[15]) << 24) | (uint32_t(p[16]) << 16) | (uint32_t(p[17]) << 8) | p[18];
+    return true;
+}
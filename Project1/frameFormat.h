@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// 帧格式常量与帧头（编码器与解码器共用）
+
+// 默认每模块像素大小（单张图像和未指定 --module-size 的流式帧）
+const int MODULE_SIZE = 10;
+// 网格四周的静区宽度（模块）
+const int BORDER = 4;
+
+// 定位标记大小与保留区域见 frameLayout.h，帧描述区见 frameDescriptor.h
+
+// 流式模式帧头：魔数(2) + 帧序号(4) + 总帧数(4) + 本帧数据长度(4)
+const uint8_t FRAME_MAGIC[2] = { 'Q', 'F' };
+const int FRAME_HEADER_SIZE = 14;
+
+// 喷泉码模式帧头：魔数(2) + 编码符号序号(4) + 源符号数(4) + 数据流总长度(4)，其后整帧为一个编码符号
+const uint8_t FOUNTAIN_MAGIC[2] = { 'Q', 'L' };
+
+// 比特有效性不小于此值的字节作为 RS 擦除：9 个采样点中至少 2 个与多数不一致
+const int DEFAULT_ERASURE_THRESHOLD = 113;
+
+// 解析后的帧头
+struct FrameHeader {
+    bool fountain = false;  // 喷泉码帧
+    uint32_t seq = 0;       // 帧序号（喷泉码帧为编码符号序号）
+    uint32_t total = 0;     // 总帧数（喷泉码帧为源符号数）
+    uint32_t length = 0;    // 本帧数据长度（喷泉码帧为数据流总长度）
+    bool compressed = false;  // 数据流为压缩流：不占帧头字节，随帧描述区的标志传递
+    bool parityErrors = false;  // 逐字节奇偶校验（无 RS）发现数据区有错：解码端标记，不占帧头字节
+};
+
+// 读取大端 32 位整数
+inline uint32_t readUint32BE(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+}
+
+// 写入大端 32 位整数
+inline void writeUint32BE(uint8_t* p, uint32_t value) {
+    p[0] = (uint8_t)(value >> 24);
+    p[1] = (uint8_t)(value >> 16);
+    p[2] = (uint8_t)(value >> 8);
+    p[3] = (uint8_t)value;
+}
+
+// 写出 FRAME_HEADER_SIZE 字节的帧头
+inline void writeFrameHeader(uint8_t* out, const FrameHeader& header) {
+    const uint8_t* magic = header.fountain ? FOUNTAIN_MAGIC : FRAME_MAGIC;
+    out[0] = magic[0];
+    out[1] = magic[1];
+    writeUint32BE(out + 2, header.seq);
+    writeUint32BE(out + 6, header.total);
+    writeUint32BE(out + 10, header.length);
+}
+
+// 解析帧头字段（不检查数据长度）
+inline bool parseFrameHeader(const uint8_t* bytes, FrameHeader& header) {
+    if (bytes[0] == FRAME_MAGIC[0] && bytes[1] == FRAME_MAGIC[1]) {
+        header.fountain = false;
+    }
+    else if (bytes[0] == FOUNTAIN_MAGIC[0] && bytes[1] == FOUNTAIN_MAGIC[1]) {
+        header.fountain = true;
+    }
+    else {
+        return false;
+    }
+    header.seq = readUint32BE(&bytes[2]);
+    header.total = readUint32BE(&bytes[6]);
+    header.length = readUint32BE(&bytes[10]);
+    return header.total > 0 && (header.fountain || header.seq < header.total);
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// 定位标记大小（编码器与解码器共用）
+const int FINDER_PATTERN_SIZE = 7;
+const int FINDER_BORDER = 1;
+
+// 检测定位标记区域（保留区域的唯一判定依据，仅在构建布局时调用）
+inline bool isFinderPatternArea(int x, int y, int widthCount, int heightCount) {
+    // 左上定位标记区域
+    if (x < FINDER_PATTERN_SIZE + FINDER_BORDER &&
+        y < FINDER_PATTERN_SIZE + FINDER_BORDER) {
+        return true;
+    }
+    // 右上定位标记区域
+    if (x >= widthCount - FINDER_PATTERN_SIZE - FINDER_BORDER &&
+        y < FINDER_PATTERN_SIZE + FINDER_BORDER) {
+        return true;
+    }
+    // 左下定位标记区域
+    if (x < FINDER_PATTERN_SIZE + FINDER_BORDER &&
+        y >= heightCount - FINDER_PATTERN_SIZE - FINDER_BORDER) {
+        return true;
+    }
+    // 对齐标记区域（如果存在，5x5，中心位于 (widthCount - 4, heightCount - 4)）
+    if (widthCount > 15 && heightCount > 15 &&
+        x >= widthCount - 6 && x < widthCount - 1 &&
+        y >= heightCount - 6 && y < heightCount - 1) {
+        return true;
+    }
+    return false;
+}
+
+// 定时线（宽网格）：从定位标记区域外侧第一行 / 列起每隔 TIMING_PERIOD 个模块一条贯穿网格的定时行 / 定时列，
+// 黑白交替（行上偶数列为黑，列上偶数行为黑，交点两者一致），让出定位标记、帧描述区和校准色块。
+// 解码器沿定时线测出每个模块边界的实际位置，逐行、逐列修正采样点（见 frameLocator.h 的 TimingCorrection）
+const int TIMING_FIRST = FINDER_PATTERN_SIZE + FINDER_BORDER;
+const int TIMING_PERIOD = 64;
+const int TIMING_MIN_WIDTH = 128;   // 网格宽度不小于此值时才绘制定时线（是否绘制由帧描述区标志给出）
+static_assert(TIMING_FIRST % 2 == 0 && TIMING_PERIOD % 2 == 0, "timing lines must cross on dark modules");
+
+// 第 i 行（列）是否为定时线，count 为网格高（宽）
+inline bool isTimingLine(int i, int count) {
+    return i >= TIMING_FIRST && i < count - TIMING_FIRST && (i - TIMING_FIRST) % TIMING_PERIOD == 0;
+}
+
+// 编码器按网格尺寸决定是否使用定时线
+inline bool timingPatternsUsed(int widthCount, int heightCount) {
+    return widthCount >= TIMING_MIN_WIDTH && heightCount > 2 * TIMING_FIRST;
+}
+
+inline bool isTimingPatternArea(int x, int y, int widthCount, int heightCount) {
+    return isTimingLine(y, heightCount) || isTimingLine(x, widthCount);
+}
+
+// 定时线上模块的颜色
+inline bool timingModuleDark(int x, int y, int heightCount) {
+    return isTimingLine(y, heightCount) ? (x % 2 == 0) : (y % 2 == 0);
+}
+
+// 帧描述区（流式帧）：左上定位标记右侧的 8 行 x 40 列，内容见 frameDescriptor.h
+const int DESCRIPTOR_AREA_LEFT = FINDER_PATTERN_SIZE + FINDER_BORDER;
+const int DESCRIPTOR_AREA_WIDTH = 40;
+const int DESCRIPTOR_AREA_HEIGHT = FINDER_PATTERN_SIZE + FINDER_BORDER;
+
+inline bool isDescriptorArea(int x, int y) {
+    return y < DESCRIPTOR_AREA_HEIGHT && x >= DESCRIPTOR_AREA_LEFT && x < DESCRIPTOR_AREA_LEFT + DESCRIPTOR_AREA_WIDTH;
+}
+
+// 多电平调制的校准色块：每个电平重复 CALIBRATION_REPEAT 个模块，
+// 位于最后一行、左下定位标记区域右侧
+const int CALIBRATION_REPEAT = 2;
+
+// 数据模块坐标（不含边框，单位为模块）
+struct ModuleCoord {
+    uint16_t x;
+    uint16_t y;
+};
+
+const uint8_t RESERVED_TIMING = 2;   // FrameLayout::reserved 中定时线模块的取值
+
+// 帧布局：按 (widthCount, heightCount, calibrationLevels, descriptor, timing) 构建一次，编码器与解码器直接遍历 dataModules
+struct FrameLayout {
+    int widthCount;
+    int heightCount;
+    std::vector<uint8_t> reserved;                // 每模块一字节，1 = 定位/对齐标记、校准色块、帧描述区等保留区域，
+                                                  // RESERVED_TIMING = 定时线
+    std::vector<ModuleCoord> dataModules;         // 数据模块坐标，按比特写入顺序排列
+    std::vector<uint32_t> rowStart;               // 第 y 行第一个数据模块在 dataModules 中的下标（共 heightCount + 1 项）
+    std::vector<ModuleCoord> calibrationModules;  // 校准色块，电平 k 占 [k * CALIBRATION_REPEAT, (k + 1) * CALIBRATION_REPEAT)
+    std::vector<int> timingRows;                  // 定时行、定时列的网格坐标（升序）
+    std::vector<int> timingColumns;
+
+    FrameLayout(int width, int height, int calibrationLevels = 0, bool descriptor = false, bool timing = false)
+        : widthCount(width), heightCount(height) {
+        reserved.assign((size_t)width * height, 0);
+
+        int calibrationStart = FINDER_PATTERN_SIZE + FINDER_BORDER;
+        int calibrationCount = calibrationLevels * CALIBRATION_REPEAT;
+        if (height > 0 && calibrationStart + calibrationCount <= width) {
+            for (int i = 0; i < calibrationCount; ++i) {
+                calibrationModules.push_back({ (uint16_t)(calibrationStart + i), (uint16_t)(height - 1) });
+                reserved[(size_t)(height - 1) * width + calibrationStart + i] = 1;
+            }
+        }
+
+        rowStart.reserve(height + 1);
+        for (int y = 0; y < height; ++y) {
+            rowStart.push_back((uint32_t)dataModules.size());
+            for (int x = 0; x < width; ++x) {
+                if (isFinderPatternArea(x, y, width, height) || (descriptor && isDescriptorArea(x, y))) {
+                    reserved[(size_t)y * width + x] = 1;
+                }
+                else if (reserved[(size_t)y * width + x]) {
+                    continue;
+                }
+                else if (timing && isTimingPatternArea(x, y, width, height)) {
+                    reserved[(size_t)y * width + x] = RESERVED_TIMING;
+                }
+                else {
+                    dataModules.push_back({ (uint16_t)x, (uint16_t)y });
+                }
+            }
+        }
+        rowStart.push_back((uint32_t)dataModules.size());
+
+        for (int y = 0; timing && y < height; ++y) {
+            if (isTimingLine(y, height)) {
+                timingRows.push_back(y);
+            }
+        }
+        for (int x = 0; timing && x < width; ++x) {
+            if (isTimingLine(x, width)) {
+                timingColumns.push_back(x);
+            }
+        }
+    }
+
+    bool isReserved(int x, int y) const {
+        return reserved[(size_t)y * widthCount + x] != 0;
+    }
+
+    bool isTiming(int x, int y) const {
+        return reserved[(size_t)y * widthCount + x] == RESERVED_TIMING;
+    }
+
+    size_t dataModuleCount() const {
+        return dataModules.size();
+    }
+};
+
+// 获取布局（按网格尺寸、校准电平数、是否含帧描述区和定时线缓存，线程安全；返回的引用在程序运行期间一直有效）
+inline const FrameLayout& getFrameLayout(int widthCount, int heightCount, int calibrationLevels = 0,
+    bool descriptor = false, bool timing = false) {
+    static std::map<std::tuple<int, int, int, bool, bool>, std::unique_ptr<FrameLayout>> cache;
+    static std::mutex cacheMutex;
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    std::unique_ptr<FrameLayout>& layout =
+        cache[std::make_tuple(widthCount, heightCount, calibrationLevels, descriptor, timing)];
+    if (!layout) {
+        layout.reset(new FrameLayout(widthCount, heightCount, calibrationLevels, descriptor, timing));
+    }
+    return *layout;
+}
@@ -0,0 +1,801 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "frameLayout.h"
+
+// 帧定位（解码器使用）：在二值图像（黑 < 128）中按 1:1:3:1:1 游程查找三个定位标记，
+// 按"白 - 黑 - 白"1:1:1 游程查找右下角的对齐标记，求出模块网格到像素的单应变换。
+// 采样时逐模块投影采样点，不对整幅图像做 warpPerspective
+
+// 定时线修正（宽网格的定时线见 frameLayout.h）：单应变换只由四个标记点求得，镜头畸变和缩放的微小偏差
+// 会让远离标记的采样点逐渐滑出模块。沿每条定时行测出各列模块中心的实际网格坐标、沿每条定时列测出各行的，
+// 记为相对单应变换的偏移（模块单位）；模块位于两条定时线之间时按距离线性插值，之外取最近的一条
+struct TimingCorrection {
+    std::vector<int> rows;                          // 定时行的网格行号（升序）
+    std::vector<std::vector<float>> columnShift;    // [k][x]：第 k 条定时行上测得的第 x 列中心的 x 偏移
+    std::vector<int> columns;                       // 定时列的网格列号（升序）
+    std::vector<std::vector<float>> rowShift;       // [k][y]：第 k 条定时列上测得的第 y 行中心的 y 偏移
+
+    bool empty() const {
+        return rows.empty() && columns.empty();
+    }
+
+    // 模块 (x, y) 中心的网格坐标偏移
+    void shift(int x, int y, double& dx, double& dy) const {
+        dx = interpolate(rows, columnShift, y, x);
+        dy = interpolate(columns, rowShift, x, y);
+    }
+
+private:
+    // 各条线的 table 中取第 index 项，按 position 在相邻两条线之间线性插值
+    static double interpolate(const std::vector<int>& lines, const std::vector<std::vector<float>>& table,
+        int position, int index) {
+        if (lines.empty()) {
+            return 0;
+        }
+        size_t k = std::upper_bound(lines.begin(), lines.end(), position) - lines.begin();
+        if (k == 0) {
+            return table[0][index];
+        }
+        if (k == lines.size()) {
+            return table[k - 1][index];
+        }
+        double t = (double)(position - lines[k - 1]) / (lines[k] - lines[k - 1]);
+        return table[k - 1][index] + (table[k][index] - table[k - 1][index]) * t;
+    }
+};
+
+// 帧几何：模块网格坐标（不含边框，模块 (x, y) 覆盖 [x, x + 1) x [y, y + 1)）
+// 到像素坐标（像素 (i, j) 覆盖 [i, i + 1) x [j, j + 1)）的单应变换
+struct FrameGeometry {
+    int widthCount = 0;
+    int heightCount = 0;
+    double h[9] = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };  // 行优先 3x3
+    bool nominal = false;  // 与编码器输出逐像素对齐，可直接按像素行采样
+    TimingCorrection timing;   // 采样点在单应变换之外的逐行、逐列修正（无定时线时为空）
+
+    void project(double mx, double my, double& px, double& py) const {
+        double w = h[6] * mx + h[7] * my + h[8];
+        px = (h[0] * mx + h[1] * my + h[2]) / w;
+        py = (h[3] * mx + h[4] * my + h[5]) / w;
+    }
+};
+
+// 编码器输出的标准几何：模块边长 moduleSize 像素，四周留 border 个模块的白边
+inline FrameGeometry nominalFrameGeometry(int widthCount, int heightCount, int moduleSize, int border) {
+    FrameGeometry geometry;
+    geometry.widthCount = widthCount;
+    geometry.heightCount = heightCount;
+    geometry.h[0] = moduleSize;
+    geometry.h[2] = (double)moduleSize * border;
+    geometry.h[4] = moduleSize;
+    geometry.h[5] = (double)moduleSize * border;
+    geometry.nominal = true;
+    return geometry;
+}
+
+// 两个几何的网格尺寸相同，且网格四角投影后相差不超过 tolerance 像素
+inline bool geometryClose(const FrameGeometry& a, const FrameGeometry& b, double tolerance) {
+    if (a.widthCount != b.widthCount || a.heightCount != b.heightCount) {
+        return false;
+    }
+    for (int corner = 0; corner < 4; ++corner) {
+        double mx = (corner & 1) ? a.widthCount : 0;
+        double my = (corner & 2) ? a.heightCount : 0;
+        double ax, ay, bx, by;
+        a.project(mx, my, ax, ay);
+        b.project(mx, my, bx, by);
+        if (fabs(ax - bx) > tolerance || fabs(ay - by) > tolerance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 定位标记候选：中心像素坐标、估计的模块边长、被确认的扫描行数
+struct FinderCandidate {
+    float x;
+    float y;
+    float moduleSize;
+    int count;
+};
+
+inline bool isDarkPixel(const cv::Mat& binary, int x, int y) {
+    return binary.ptr<uint8_t>(y)[x] < 128;
+}
+
+inline bool insideImage(const cv::Mat& binary, int x, int y) {
+    return x >= 0 && y >= 0 && x < binary.cols && y < binary.rows;
+}
+
+// 五段游程是否符合定位标记的 1:1:3:1:1（每段允许半个模块的偏差）
+inline bool finderRatioMatches(const int runs[5]) {
+    int total = 0;
+    for (int i = 0; i < 5; ++i) {
+        if (runs[i] == 0) {
+            return false;
+        }
+        total += runs[i];
+    }
+    if (total < FINDER_PATTERN_SIZE) {
+        return false;
+    }
+    float module = total / (float)FINDER_PATTERN_SIZE;
+    float variance = module / 2;
+    return fabs(module - runs[0]) < variance && fabs(module - runs[1]) < variance &&
+        fabs(3 * module - runs[2]) < 3 * variance &&
+        fabs(module - runs[3]) < variance && fabs(module - runs[4]) < variance;
+}
+
+// 由五段游程和最后一段之后的坐标求中心（连续坐标）
+inline float finderCenterFromEnd(const int runs[5], int end) {
+    return end - runs[4] - runs[3] - runs[2] / 2.0f;
+}
+
+// 从 (x, y) 沿 (dx, dy) 轴向两侧复核定位标记的五段游程，返回中心在该轴上的坐标（失败返回 -1）
+// 外侧各段不超过 maxCount，总长与扫描行的 originalTotal 相差不超过 40%
+inline float crossCheckFinder(const cv::Mat& binary, int x, int y, int dx, int dy,
+    int maxCount, int originalTotal) {
+    int runs[5] = { 0, 0, 0, 0, 0 };
+
+    // 负方向：中心黑、白、外框黑
+    int px = x, py = y;
+    while (insideImage(binary, px, py) && isDarkPixel(binary, px, py)) {
+        runs[2]++;
+        px -= dx;
+        py -= dy;
+    }
+    while (insideImage(binary, px, py) && !isDarkPixel(binary, px, py) && runs[1] <= maxCount) {
+        runs[1]++;
+        px -= dx;
+        py -= dy;
+    }
+    if (!insideImage(binary, px, py) || runs[1] > maxCount) {
+        return -1;
+    }
+    while (insideImage(binary, px, py) && isDarkPixel(binary, px, py) && runs[0] <= maxCount) {
+        runs[0]++;
+        px -= dx;
+        py -= dy;
+    }
+    if (runs[0] > maxCount) {
+        return -1;
+    }
+
+    // 正方向：中心黑（续）、白、外框黑
+    px = x + dx;
+    py = y + dy;
+    while (insideImage(binary, px, py) && isDarkPixel(binary, px, py)) {
+        runs[2]++;
+        px += dx;
+        py += dy;
+    }
+    while (insideImage(binary, px, py) && !isDarkPixel(binary, px, py) && runs[3] <= maxCount) {
+        runs[3]++;
+        px += dx;
+        py += dy;
+    }
+    if (!insideImage(binary, px, py) || runs[3] > maxCount) {
+        return -1;
+    }
+    while (insideImage(binary, px, py) && isDarkPixel(binary, px, py) && runs[4] <= maxCount) {
+        runs[4]++;
+        px += dx;
+        py += dy;
+    }
+    if (runs[4] > maxCount) {
+        return -1;
+    }
+
+    int total = runs[0] + runs[1] + runs[2] + runs[3] + runs[4];
+    if (5 * abs(total - originalTotal) >= 2 * originalTotal || !finderRatioMatches(runs)) {
+        return -1;
+    }
+    return finderCenterFromEnd(runs, dy ? py : px);
+}
+
+// 扫描行上找到 1:1:3:1:1 后纵向、横向各复核一次，通过后并入候选（与已有候选重合时取加权平均）
+inline bool confirmFinderCandidate(const cv::Mat& binary, const int runs[5], int row, int end,
+    std::vector<FinderCandidate>& candidates) {
+    int total = runs[0] + runs[1] + runs[2] + runs[3] + runs[4];
+    float centerX = finderCenterFromEnd(runs, end);
+    float centerY = crossCheckFinder(binary, (int)centerX, row, 0, 1, runs[2], total);
+    if (centerY < 0) {
+        return false;
+    }
+    centerX = crossCheckFinder(binary, (int)centerX, (int)centerY, 1, 0, runs[2], total);
+    if (centerX < 0) {
+        return false;
+    }
+
+    float moduleSize = total / (float)FINDER_PATTERN_SIZE;
+    for (FinderCandidate& candidate : candidates) {
+        if (fabs(centerX - candidate.x) <= moduleSize && fabs(centerY - candidate.y) <= moduleSize &&
+            fabs(moduleSize - candidate.moduleSize) <= std::max(1.0f, candidate.moduleSize)) {
+            float count = (float)candidate.count;
+            candidate.x = (candidate.x * count + centerX) / (count + 1);
+            candidate.y = (candidate.y * count + centerY) / (count + 1);
+            candidate.moduleSize = (candidate.moduleSize * count + moduleSize) / (count + 1);
+            candidate.count++;
+            return true;
+        }
+    }
+    candidates.push_back({ centerX, centerY, moduleSize, 1 });
+    return true;
+}
+
+// 逐行扫描整幅图像（超过 1080 行时隔行抽样），收集定位标记候选
+inline std::vector<FinderCandidate> findFinderCandidates(const cv::Mat& binary) {
+    std::vector<FinderCandidate> candidates;
+    int rowStep = std::max(1, binary.rows / 1080);
+
+    for (int y = rowStep / 2; y < binary.rows; y += rowStep) {
+        const uint8_t* row = binary.ptr<uint8_t>(y);
+        int runs[5] = { 0, 0, 0, 0, 0 };
+        int state = 0;  // 偶数 = 统计黑色游程，奇数 = 统计白色游程
+
+        // x == cols 视为白色，保证行末的图案也被检查
+        for (int x = 0; x <= binary.cols; ++x) {
+            bool dark = x < binary.cols && row[x] < 128;
+            if (dark) {
+                if (state & 1) {
+                    state++;
+                }
+                runs[state]++;
+            }
+            else if (state & 1) {
+                runs[state]++;
+            }
+            else if (state < 4) {
+                runs[++state]++;
+            }
+            else if (finderRatioMatches(runs) && confirmFinderCandidate(binary, runs, y, x, candidates)) {
+                runs[0] = runs[1] = runs[2] = runs[3] = runs[4] = 0;
+                state = 0;
+            }
+            else {
+                // 丢弃前两段，从第三段重新开始匹配
+                runs[0] = runs[2];
+                runs[1] = runs[3];
+                runs[2] = runs[4];
+                runs[3] = 1;
+                runs[4] = 0;
+                state = 3;
+            }
+        }
+    }
+    return candidates;
+}
+
+// 从定位标记中心沿单位方向 (dirX, dirY) 走过"中心黑 - 白 - 外框黑"三段，返回到外框外缘的距离
+// （出界或超过 maxLength 返回 -1）
+inline float finderEdgeDistance(const cv::Mat& binary, const FinderCandidate& finder,
+    float dirX, float dirY, float maxLength) {
+    int state = 0;  // 0 = 中心黑，1 = 白，2 = 外框黑
+    for (float t = 0; t < maxLength; t += 0.25f) {
+        int x = (int)floorf(finder.x + dirX * t);
+        int y = (int)floorf(finder.y + dirY * t);
+        if (!insideImage(binary, x, y)) {
+            return -1;
+        }
+        bool dark = isDarkPixel(binary, x, y);
+        if (state == 1 && dark) {
+            state = 2;
+        }
+        else if (state != 1 && !dark) {
+            if (state == 2) {
+                return t;
+            }
+            state = 1;
+        }
+    }
+    return -1;
+}
+
+// 沿单位方向 (dirX, dirY) 测量定位标记的模块边长（中心到两侧外缘各为 3.5 个模块）。
+// 扫描行得到的 moduleSize 在旋转时偏大，这里按实际方向重新测量
+inline float finderModuleSizeAlong(const cv::Mat& binary, const FinderCandidate& finder, float dirX, float dirY) {
+    float maxLength = 2 * FINDER_PATTERN_SIZE * finder.moduleSize;
+    float forward = finderEdgeDistance(binary, finder, dirX, dirY, maxLength);
+    float backward = finderEdgeDistance(binary, finder, -dirX, -dirY, maxLength);
+    if (forward < 0 && backward < 0) {
+        return finder.moduleSize;
+    }
+    if (forward < 0 || backward < 0) {
+        return 2 * std::max(forward, backward) / FINDER_PATTERN_SIZE;
+    }
+    return (forward + backward) / FINDER_PATTERN_SIZE;
+}
+
+// 以模块向量 (ux, uy) 校验定位标记模板（7x7 图案加一圈白色分隔/边框，共 9x9 个模块），返回不符的模块数
+inline int finderTemplateMismatches(const cv::Mat& binary, const FinderCandidate& finder,
+    float uxX, float uxY, float uyX, float uyY) {
+    const int reach = FINDER_PATTERN_SIZE / 2 + FINDER_BORDER;
+    int mismatches = 0;
+    for (int dy = -reach; dy <= reach; ++dy) {
+        for (int dx = -reach; dx <= reach; ++dx) {
+            int ring = std::max(abs(dx), abs(dy));
+            bool dark = (ring <= 1 || ring == 3);
+            int px = (int)floorf(finder.x + dx * uxX + dy * uyX);
+            int py = (int)floorf(finder.y + dx * uxY + dy * uyY);
+            if (!insideImage(binary, px, py) || isDarkPixel(binary, px, py) != dark) {
+                mismatches++;
+            }
+        }
+    }
+    return mismatches;
+}
+
+// 从候选中选出三个定位标记：模块大小相近、构成近似直角、按两条边的方向校验模板，按左上、右上、左下返回
+inline bool selectFinderPatterns(const cv::Mat& binary, std::vector<FinderCandidate> candidates,
+    FinderCandidate& topLeft, FinderCandidate& topRight, FinderCandidate& bottomLeft) {
+    std::sort(candidates.begin(), candidates.end(),
+        [](const FinderCandidate& a, const FinderCandidate& b) { return a.count > b.count; });
+    // 真正的定位标记中心有 3 个模块高，被确认的扫描行数约为数据区偶然匹配的 3 倍；
+    // 只保留确认次数不低于第三名一半的候选
+    if (candidates.size() > 3) {
+        int minCount = std::max(2, candidates[2].count / 2);
+        candidates.erase(std::remove_if(candidates.begin() + 3, candidates.end(),
+            [&](const FinderCandidate& c) { return c.count < minCount; }), candidates.end());
+    }
+    if (candidates.size() > 8) {
+        candidates.resize(8);
+    }
+
+    float bestScore = 1e9f;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        for (size_t j = i + 1; j < candidates.size(); ++j) {
+            for (size_t k = j + 1; k < candidates.size(); ++k) {
+                const FinderCandidate* p[3] = { &candidates[i], &candidates[j], &candidates[k] };
+                float minSize = std::min({ p[0]->moduleSize, p[1]->moduleSize, p[2]->moduleSize });
+                float maxSize = std::max({ p[0]->moduleSize, p[1]->moduleSize, p[2]->moduleSize });
+                if (maxSize > 1.5f * minSize) {
+                    continue;
+                }
+
+                // 直角顶点与最长边相对
+                float side[3];
+                for (int v = 0; v < 3; ++v) {
+                    const FinderCandidate* a = p[(v + 1) % 3];
+                    const FinderCandidate* b = p[(v + 2) % 3];
+                    side[v] = hypotf(a->x - b->x, a->y - b->y);
+                }
+                int corner = (int)(std::max_element(side, side + 3) - side);
+                const FinderCandidate* a = p[corner];
+                const FinderCandidate* b = p[(corner + 1) % 3];
+                const FinderCandidate* c = p[(corner + 2) % 3];
+                float abLength = hypotf(b->x - a->x, b->y - a->y);
+                float acLength = hypotf(c->x - a->x, c->y - a->y);
+                if (std::min(abLength, acLength) < 2 * FINDER_PATTERN_SIZE * minSize) {
+                    continue;
+                }
+                float cosine = ((b->x - a->x) * (c->x - a->x) + (b->y - a->y) * (c->y - a->y)) /
+                    (abLength * acLength);
+                if (fabs(cosine) > 0.3f) {
+                    continue;
+                }
+
+                // 数据区的偶然匹配在二维模板上几乎必然不符（允许 15% 的模块受噪声影响）
+                float abX = (b->x - a->x) / abLength, abY = (b->y - a->y) / abLength;
+                float acX = (c->x - a->x) / acLength, acY = (c->y - a->y) / acLength;
+                int mismatches = 0;
+                for (int v = 0; v < 3; ++v) {
+                    float sizeAB = finderModuleSizeAlong(binary, *p[v], abX, abY);
+                    float sizeAC = finderModuleSizeAlong(binary, *p[v], acX, acY);
+                    mismatches += finderTemplateMismatches(binary, *p[v],
+                        abX * sizeAB, abY * sizeAB, acX * sizeAC, acY * sizeAC);
+                }
+                const int templateModules = 3 * (FINDER_PATTERN_SIZE + 2 * FINDER_BORDER) *
+                    (FINDER_PATTERN_SIZE + 2 * FINDER_BORDER);
+                if (mismatches * 100 > templateModules * 15) {
+                    continue;
+                }
+
+                float score = fabs(cosine) + (maxSize / minSize - 1) / 2 + 2.0f * mismatches / templateModules;
+                if (score < bestScore) {
+                    bestScore = score;
+                    // 图像坐标 y 向下：右上 - 左上 与 左下 - 左上 的叉积为正
+                    float cross = (b->x - a->x) * (c->y - a->y) - (b->y - a->y) * (c->x - a->x);
+                    topLeft = *a;
+                    topRight = (cross > 0) ? *b : *c;
+                    bottomLeft = (cross > 0) ? *c : *b;
+                }
+            }
+        }
+    }
+    return bestScore < 1e9f;
+}
+
+// 对齐标记（5x5：外框黑、一圈白、中心黑）相对中心 (dx, dy) 模块处的颜色
+inline bool alignmentTemplateDark(int dx, int dy) {
+    return std::max(abs(dx), abs(dy)) != 1;
+}
+
+// 在预测位置附近 radiusModules 个模块内查找对齐标记：按行查找两侧为黑色的"白 - 黑 - 白"1:1:1 游程，
+// 纵向复核中心后按模块向量 (ux, uy) 校验整个 5x5 模板（最多 2 个模块不符）；返回离预测位置最近的结果
+inline bool findAlignmentPattern(const cv::Mat& binary, float predictedX, float predictedY,
+    float uxX, float uxY, float uyX, float uyY, int radiusModules, float& foundX, float& foundY) {
+    float moduleSize = std::max(1.0f, (hypotf(uxX, uxY) + hypotf(uyX, uyY)) / 2);
+    int radius = (int)ceilf(radiusModules * moduleSize);
+    int x0 = std::max(0, (int)predictedX - radius);
+    int x1 = std::min(binary.cols, (int)predictedX + radius);
+    int y0 = std::max(0, (int)predictedY - radius);
+    int y1 = std::min(binary.rows, (int)predictedY + radius);
+    auto runMatches = [&](int run) { return fabs(run - moduleSize) < moduleSize / 2 + 0.5f; };
+
+    float bestDistance = 1e9f;
+    std::vector<int> runStart;
+    for (int y = y0; y < y1; ++y) {
+        const uint8_t* row = binary.ptr<uint8_t>(y);
+        runStart.clear();
+        for (int x = x0; x < x1; ++x) {
+            if (x == x0 || (row[x] < 128) != (row[x - 1] < 128)) {
+                runStart.push_back(x);
+            }
+        }
+        runStart.push_back(x1);
+
+        // 第 r 段为中心黑色，前后各一段白色，再外侧为黑色
+        for (size_t r = 2; r + 3 < runStart.size(); ++r) {
+            if (row[runStart[r]] >= 128 ||
+                !runMatches(runStart[r] - runStart[r - 1]) ||
+                !runMatches(runStart[r + 1] - runStart[r]) ||
+                !runMatches(runStart[r + 2] - runStart[r + 1])) {
+                continue;
+            }
+            float centerX = (runStart[r] + runStart[r + 1]) / 2.0f;
+
+            // 纵向复核：沿中心列向上、向下各走过中心黑与白，再遇到黑色
+            int column = (int)centerX;
+            int up = y, down = y;
+            while (up > 0 && isDarkPixel(binary, column, up - 1)) up--;
+            while (down + 1 < binary.rows && isDarkPixel(binary, column, down + 1)) down++;
+            if (!runMatches(down - up + 1)) {
+                continue;
+            }
+            float centerY = (up + down + 1) / 2.0f;
+
+            int mismatches = 0;
+            for (int dy = -2; dy <= 2 && mismatches <= 2; ++dy) {
+                for (int dx = -2; dx <= 2; ++dx) {
+                    int px = (int)floorf(centerX + dx * uxX + dy * uyX);
+                    int py = (int)floorf(centerY + dx * uxY + dy * uyY);
+                    if (!insideImage(binary, px, py) ||
+                        isDarkPixel(binary, px, py) != alignmentTemplateDark(dx, dy)) {
+                        mismatches++;
+                    }
+                }
+            }
+            float distance = hypotf(centerX - predictedX, centerY - predictedY);
+            if (mismatches <= 2 && distance < bestDistance) {
+                bestDistance = distance;
+                foundX = centerX;
+                foundY = centerY;
+            }
+        }
+    }
+    return bestDistance < 1e9f;
+}
+
+// 给定模块网格尺寸，由三个定位标记与右下角参考点（对齐标记中心）求单应变换
+inline FrameGeometry fitFrameGeometry(int widthCount, int heightCount, const cv::Point2f corners[4]) {
+    const float center = FINDER_PATTERN_SIZE / 2.0f;
+    cv::Point2f grid[4] = {
+        cv::Point2f(center, center),
+        cv::Point2f(widthCount - center, center),
+        cv::Point2f(center, heightCount - center),
+        cv::Point2f(widthCount - center, heightCount - center)
+    };
+    cv::Mat homography = cv::getPerspectiveTransform(grid, corners);
+
+    FrameGeometry geometry;
+    geometry.widthCount = widthCount;
+    geometry.heightCount = heightCount;
+    for (int i = 0; i < 9; ++i) {
+        geometry.h[i] = homography.at<double>(i / 3, i % 3);
+    }
+    return geometry;
+}
+
+// 改变网格尺寸：保持三个定位标记与对齐标记中心的像素位置不变，按新的模块数重新求单应变换
+inline FrameGeometry resizeFrameGeometry(const FrameGeometry& geometry, int widthCount, int heightCount) {
+    const double center = FINDER_PATTERN_SIZE / 2.0;
+    cv::Point2f corners[4];
+    for (int corner = 0; corner < 4; ++corner) {
+        double mx = (corner & 1) ? geometry.widthCount - center : center;
+        double my = (corner & 2) ? geometry.heightCount - center : center;
+        double px, py;
+        geometry.project(mx, my, px, py);
+        corners[corner] = cv::Point2f((float)px, (float)py);
+    }
+    return fitFrameGeometry(widthCount, heightCount, corners);
+}
+
+// 网格与图像的失配程度：在 [x0, x1) x [y0, y1) 的模块上做 3x3 投票，累计少数票数。
+// 网格尺寸正确时采样点都落在模块中心附近，失配最小
+inline double gridMisfit(const cv::Mat& binary, const FrameGeometry& geometry, int x0, int x1, int y0, int y1) {
+    const double offset = 0.3;
+    long misfit = 0;
+    long modules = 0;
+    for (int my = y0; my < y1; ++my) {
+        for (int mx = x0; mx < x1; ++mx) {
+            int vote = 0;
+            int total = 0;
+            for (int j = -1; j <= 1; ++j) {
+                for (int i = -1; i <= 1; ++i) {
+                    double px, py;
+                    geometry.project(mx + 0.5 + i * offset, my + 0.5 + j * offset, px, py);
+                    int x = (int)floor(px);
+                    int y = (int)floor(py);
+                    if (insideImage(binary, x, y)) {
+                        vote += isDarkPixel(binary, x, y);
+                        total++;
+                    }
+                }
+            }
+            misfit += std::min(vote, total - vote);
+            modules++;
+        }
+    }
+    return modules ? (double)misfit / modules : 0;
+}
+
+// 在 estimate 附近选出失配最小的模块数；misfitOf(count) 给出该模块数下的失配程度，相同时取更接近估计值的
+template <typename MisfitFunction>
+inline int refineModuleCount(int estimate, int minimum, MisfitFunction misfitOf) {
+    int radius = 2 + estimate / 50;
+    int best = std::max(estimate, minimum);
+    double bestMisfit = misfitOf(best);
+    for (int distance = 1; distance <= radius; ++distance) {
+        for (int sign = -1; sign <= 1; sign += 2) {
+            int count = estimate + sign * distance;
+            if (count < minimum) {
+                continue;
+            }
+            double misfit = misfitOf(count);
+            if (misfit < bestMisfit) {
+                bestMisfit = misfit;
+                best = count;
+            }
+        }
+    }
+    return best;
+}
+
+// 定位帧：找到三个定位标记后由标记间距估计网格尺寸，再在定位标记之间的数据模块上按失配程度微调；
+// 找到对齐标记时用四点求单应变换（搜索位置按定位标记的模块边长推算透视），否则按平行四边形补出第四点（仿射）
+inline bool locateFrame(const cv::Mat& binary, FrameGeometry& geometry) {
+    FinderCandidate topLeft, topRight, bottomLeft;
+    if (!selectFinderPatterns(binary, findFinderCandidates(binary), topLeft, topRight, bottomLeft)) {
+        return false;
+    }
+
+    float topLength = hypotf(topRight.x - topLeft.x, topRight.y - topLeft.y);
+    float leftLength = hypotf(bottomLeft.x - topLeft.x, bottomLeft.y - topLeft.y);
+    float topX = (topRight.x - topLeft.x) / topLength, topY = (topRight.y - topLeft.y) / topLength;
+    float leftX = (bottomLeft.x - topLeft.x) / leftLength, leftY = (bottomLeft.y - topLeft.y) / leftLength;
+    float topRightModule = finderModuleSizeAlong(binary, topRight, topX, topY);
+    float bottomLeftModule = finderModuleSizeAlong(binary, bottomLeft, leftX, leftY);
+    float topModule = (finderModuleSizeAlong(binary, topLeft, topX, topY) + topRightModule) / 2;
+    float leftModule = (finderModuleSizeAlong(binary, topLeft, leftX, leftY) + bottomLeftModule) / 2;
+    int minCount = 2 * (FINDER_PATTERN_SIZE + FINDER_BORDER);
+    int widthEstimate = (int)lroundf(topLength / topModule) + FINDER_PATTERN_SIZE;
+    int heightEstimate = (int)lroundf(leftLength / leftModule) + FINDER_PATTERN_SIZE;
+    if (widthEstimate < minCount || heightEstimate < minCount) {
+        return false;
+    }
+
+    cv::Point2f corners[4] = {
+        cv::Point2f(topLeft.x, topLeft.y),
+        cv::Point2f(topRight.x, topRight.y),
+        cv::Point2f(bottomLeft.x, bottomLeft.y),
+        cv::Point2f(topRight.x + bottomLeft.x - topLeft.x, topRight.y + bottomLeft.y - topLeft.y)
+    };
+    // 透视下平行四边形的预测会偏离对齐标记很远（5% 梯形时约 17 个模块）。单应变换的齐次分量 w 在网格上是仿射的，
+    // 沿一条直线的局部模块边长与 w^2 成反比，于是由定位标记沿上边、左边的模块边长之比求出 wTR / wTL、wBL / wTL，
+    // 推出 wBR = wTR + wBL - wTL，右下角 = (TR * wTR + BL * wBL - TL * wTL) / wBR。
+    // 模板的模块向量取下边、右边的方向，边长按 (w / wBR)^2 换算到右下角；先在该预测位置附近查找，
+    // 找不到再按平行四边形的预测和右上、左下定位标记处的模块向量查找
+    struct AlignmentSearch {
+        cv::Point2f center;
+        float uxX, uxY, uyX, uyY;
+    };
+    std::vector<AlignmentSearch> searches;
+    if (widthEstimate > 15 && heightEstimate > 15) {
+        float topRightW = sqrtf(finderModuleSizeAlong(binary, topLeft, topX, topY) / topRightModule);
+        float bottomLeftW = sqrtf(finderModuleSizeAlong(binary, topLeft, leftX, leftY) / bottomLeftModule);
+        float bottomRightW = topRightW + bottomLeftW - 1;
+        if (std::isfinite(bottomRightW) && bottomRightW > 0.5f) {
+            cv::Point2f center(
+                (topRight.x * topRightW + bottomLeft.x * bottomLeftW - topLeft.x) / bottomRightW,
+                (topRight.y * topRightW + bottomLeft.y * bottomLeftW - topLeft.y) / bottomRightW);
+            float bottomLength = hypotf(center.x - bottomLeft.x, center.y - bottomLeft.y);
+            float rightLength = hypotf(center.x - topRight.x, center.y - topRight.y);
+            float ux = topRightModule * (topRightW / bottomRightW) * (topRightW / bottomRightW) / bottomLength;
+            float uy = bottomLeftModule * (bottomLeftW / bottomRightW) * (bottomLeftW / bottomRightW) / rightLength;
+            searches.push_back({ center, (center.x - bottomLeft.x) * ux, (center.y - bottomLeft.y) * ux,
+                (center.x - topRight.x) * uy, (center.y - topRight.y) * uy });
+        }
+        searches.push_back({ corners[3], topX * topRightModule, topY * topRightModule,
+            leftX * bottomLeftModule, leftY * bottomLeftModule });
+    }
+    bool alignmentFound = false;
+    for (size_t s = 0; s < searches.size() && !alignmentFound; ++s) {
+        const AlignmentSearch& search = searches[s];
+        for (int radiusModules = 8; radiusModules <= 16 && !alignmentFound; radiusModules *= 2) {
+            float alignmentX, alignmentY;
+            if (findAlignmentPattern(binary, search.center.x, search.center.y,
+                search.uxX, search.uxY, search.uyX, search.uyY, radiusModules, alignmentX, alignmentY)) {
+                corners[3] = cv::Point2f(alignmentX, alignmentY);
+                alignmentFound = true;
+            }
+        }
+    }
+
+    // 宽度用左上、右上定位标记之间的行微调，高度用左上、左下之间的列微调
+    const int finderArea = FINDER_PATTERN_SIZE + FINDER_BORDER;
+    int widthCount = refineModuleCount(widthEstimate, minCount, [&](int count) {
+        return gridMisfit(binary, fitFrameGeometry(count, heightEstimate, corners),
+            finderArea, count - finderArea, 0, FINDER_PATTERN_SIZE);
+    });
+    int heightCount = refineModuleCount(heightEstimate, minCount, [&](int count) {
+        return gridMisfit(binary, fitFrameGeometry(widthCount, count, corners),
+            0, FINDER_PATTERN_SIZE, finderArea, count - finderArea);
+    });
+
+    geometry = fitFrameGeometry(widthCount, heightCount, corners);
+    return true;
+}
+
+// 灰度图在连续像素坐标 (x, y) 处的双线性插值，出界返回 -1
+inline float sampleGrayBilinear(const cv::Mat& gray, double x, double y) {
+    x -= 0.5;
+    y -= 0.5;
+    int x0 = (int)floor(x);
+    int y0 = (int)floor(y);
+    if (x0 < 0 || y0 < 0 || x0 + 1 >= gray.cols || y0 + 1 >= gray.rows) {
+        return -1;
+    }
+    float fx = (float)(x - x0);
+    float fy = (float)(y - y0);
+    const uint8_t* top = gray.ptr<uint8_t>(y0) + x0;
+    const uint8_t* bottom = gray.ptr<uint8_t>(y0 + 1) + x0;
+    float upper = top[0] + (top[1] - top[0]) * fx;
+    float lower = bottom[0] + (bottom[1] - bottom[0]) * fx;
+    return upper + (lower - upper) * fy;
+}
+
+const int TIMING_PROFILE_STEPS = 8;       // 每个模块边界的剖面采样点数（跨一个模块）
+const float TIMING_MIN_CONTRAST = 24;     // 相邻两个定时模块中心的最小灰度差
+
+// 沿一条定时线测量各模块中心相对单应变换的偏移：line 为定时行（alongX）或定时列的网格坐标，
+// 跨轴方向按 cross 已有的修正取中线。依次在每个边界附近一个模块宽的窗口内取灰度剖面，
+// 按两侧模块中心灰度的中值求亚像素过零点；窗口中心随上一个边界的偏移推进，逐渐累积的漂移也能跟上。
+// 模块中心取左右两个边界的平均（黑块因模糊或阈值变宽时两侧的偏差相互抵消），
+// 测不到的位置由相邻测量值线性插值；有效测量太少时返回 false
+inline bool measureTimingLine(const cv::Mat& gray, const FrameGeometry& geometry, const FrameLayout& layout,
+    const TimingCorrection& cross, bool alongX, int line, std::vector<float>& shift) {
+    int count = alongX ? layout.widthCount : layout.heightCount;
+    std::vector<float> edge(count + 1, 0);
+    std::vector<uint8_t> measured(count + 1, 0);
+    float profile[TIMING_PROFILE_STEPS + 1];
+    double drift = 0;
+    int found = 0;
+    for (int b = 1; b < count; ++b) {
+        int x0 = alongX ? b - 1 : line, y0 = alongX ? line : b - 1;
+        int x1 = alongX ? b : line, y1 = alongX ? line : b;
+        if (!layout.isTiming(x0, y0) || !layout.isTiming(x1, y1)) {
+            continue;
+        }
+        double dx, dy;
+        cross.shift(x1, y1, dx, dy);
+        double center = (alongX ? line + dy : line + dx) + 0.5;
+        double start = b + drift - 0.5;
+        bool inside = true;
+        for (int s = 0; s <= TIMING_PROFILE_STEPS && inside; ++s) {
+            double u = start + (double)s / TIMING_PROFILE_STEPS;
+            double px, py;
+            if (alongX) {
+                geometry.project(u, center, px, py);
+            }
+            else {
+                geometry.project(center, u, px, py);
+            }
+            profile[s] = sampleGrayBilinear(gray, px, py);
+            inside = profile[s] >= 0;
+        }
+        // 前一个模块应为黑（偶数）时剖面由暗变亮，反之由亮变暗
+        float rise = profile[TIMING_PROFILE_STEPS] - profile[0];
+        bool darkFirst = (b - 1) % 2 == 0;
+        if (!inside || (darkFirst ? rise : -rise) < TIMING_MIN_CONTRAST) {
+            continue;
+        }
+        float threshold = (profile[0] + profile[TIMING_PROFILE_STEPS]) / 2;
+        double best = -1;
+        for (int s = 0; s < TIMING_PROFILE_STEPS; ++s) {
+            float a = profile[s] - threshold;
+            float c = profile[s + 1] - threshold;
+            if ((a < 0) != (c < 0) || a == 0) {
+                double crossing = s + a / (a - c);
+                if (best < 0 || fabs(crossing - TIMING_PROFILE_STEPS / 2.0) < fabs(best - TIMING_PROFILE_STEPS / 2.0)) {
+                    best = crossing;
+                }
+            }
+        }
+        if (best < 0) {
+            continue;
+        }
+        drift = start + best / TIMING_PROFILE_STEPS - b;
+        edge[b] = (float)drift;
+        measured[b] = 1;
+        found++;
+    }
+    if (found < 4) {
+        return false;
+    }
+
+    // 模块中心 = 两侧边界的平均；只有一侧时取该侧
+    shift.assign(count, 0);
+    std::vector<uint8_t> known(count, 0);
+    for (int i = 0; i < count; ++i) {
+        if (measured[i] || measured[i + 1]) {
+            shift[i] = (measured[i] && measured[i + 1]) ? (edge[i] + edge[i + 1]) / 2 : (measured[i] ? edge[i] : edge[i + 1]);
+            known[i] = 1;
+        }
+    }
+    // 空缺按两侧最近的测量值线性插值，两端外推取最近值
+    int previous = -1;
+    for (int i = 0; i <= count; ++i) {
+        if (i < count && !known[i]) {
+            continue;
+        }
+        for (int j = previous + 1; j < i; ++j) {
+            if (previous < 0) {
+                shift[j] = shift[i];
+            }
+            else if (i == count) {
+                shift[j] = shift[previous];
+            }
+            else {
+                shift[j] = shift[previous] + (shift[i] - shift[previous]) * (j - previous) / (float)(i - previous);
+            }
+        }
+        previous = i;
+    }
+    return true;
+}
+
+// 由定时线拟合逐行、逐列修正，结果写入 geometry.timing：先测定时行（跨轴不修正），
+// 再按其结果测定时列，最后按定时列的结果重测定时行
+inline void fitTimingPatterns(const cv::Mat& gray, const FrameLayout& layout, FrameGeometry& geometry) {
+    TimingCorrection fitted;
+    auto measureAll = [&](bool alongX) {
+        const std::vector<int>& lines = alongX ? layout.timingRows : layout.timingColumns;
+        std::vector<int> kept;
+        std::vector<std::vector<float>> shifts;
+        std::vector<float> shift;
+        for (int line : lines) {
+            if (measureTimingLine(gray, geometry, layout, fitted, alongX, line, shift)) {
+                kept.push_back(line);
+                shifts.push_back(shift);
+            }
+        }
+        if (alongX) {
+            fitted.rows.swap(kept);
+            fitted.columnShift.swap(shifts);
+        }
+        else {
+            fitted.columns.swap(kept);
+            fitted.rowShift.swap(shifts);
+        }
+    };
+    measureAll(true);
+    measureAll(false);
+    measureAll(true);
+    geometry.timing = fitted;
+}
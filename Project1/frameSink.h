@@ -0,0 +1,215 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+// 编码帧的输出端：编码器逐帧交给 FrameSink，由它决定写到哪里、用什么格式。
+//   png[:N]   每帧一个 PNG 文件（<前缀>_NNNNNN.png）；给出 N 时使用 zlib 压缩级别 N（0..9）和 RLE 策略，
+//             黑白块状图像上 N = 1 比默认设置快得多而文件大小相近
+//   pgm       每帧一个未压缩的 PGM 文件（8 色帧为 PPM），写出只是一次内存复制
+//   raw       所有帧的像素依次写入同一个文件，"-" 为标准输出（灰度或 BGR24，无文件头），
+//             可直接用管道交给播放或传输程序，如 ffmpeg -f rawvideo -pix_fmt gray -s WxH -i -
+//   video[:F] 所有帧写入同一个无损视频（FFV1，建议 .mkv / .avi 容器），帧率 F（默认 30），
+//             可直接交给 decode --video；后端不支持 FFV1 时打开失败
+enum SinkKind {
+    SINK_PNG,
+    SINK_PGM,
+    SINK_RAW,
+    SINK_VIDEO
+};
+
+struct SinkSpec {
+    SinkKind kind = SINK_PNG;
+    int pngLevel = -1;   // -1 = OpenCV 默认压缩设置
+    double fps = 30;
+};
+
+// 解析 --sink 的取值，格式见上
+inline bool parseSinkSpec(const std::string& text, SinkSpec& spec) {
+    std::string name = text.substr(0, text.find(':'));
+    std::string value = (name.size() < text.size()) ? text.substr(name.size() + 1) : "";
+    char* end = nullptr;
+    spec = SinkSpec();
+    if (name == "png") {
+        spec.kind = SINK_PNG;
+        if (!value.empty()) {
+            spec.pngLevel = (int)std::strtol(value.c_str(), &end, 10);
+            return *end == '\0' && spec.pngLevel >= 0 && spec.pngLevel <= 9;
+        }
+        return true;
+    }
+    if (name == "video") {
+        spec.kind = SINK_VIDEO;
+        if (!value.empty()) {
+            spec.fps = std::strtod(value.c_str(), &end);
+            return *end == '\0' && spec.fps > 0;
+        }
+        return true;
+    }
+    if (name == "pgm" || name == "raw") {
+        spec.kind = (name == "pgm") ? SINK_PGM : SINK_RAW;
+        return value.empty();
+    }
+    return false;
+}
+
+// PNG 写出参数（单张图像模式也使用）
+inline std::vector<int> pngWriteParams(const SinkSpec& spec) {
+    if (spec.pngLevel < 0) {
+        return std::vector<int>();
+    }
+    return { cv::IMWRITE_PNG_COMPRESSION, spec.pngLevel, cv::IMWRITE_PNG_STRATEGY, cv::IMWRITE_PNG_STRATEGY_RLE };
+}
+
+class FrameSink {
+public:
+    virtual ~FrameSink() {}
+    // 写出第 seq 帧；失败时返回 false，error() 给出原因
+    virtual bool write(uint32_t seq, const cv::Mat& frame) = 0;
+    // 结束输出（视频写完容器尾部，文件刷新并关闭）
+    virtual bool close() { return true; }
+    const std::string& error() const { return message; }
+
+protected:
+    std::string message;
+};
+
+// 每帧一个图像文件：<前缀>_NNNNNN.<扩展名>
+class ImageFileSink : public FrameSink {
+public:
+    ImageFileSink(const std::string& prefix, const std::string& extension, const std::vector<int>& params)
+        : prefix(prefix), extension(extension), params(params) {}
+
+    bool write(uint32_t seq, const cv::Mat& frame) override {
+        char suffix[16];
+        snprintf(suffix, sizeof(suffix), "_%06u.", seq);
+        // PGM 只能存单通道，8 色帧改写 PPM
+        std::string path = prefix + suffix + ((extension == "pgm" && frame.channels() == 3) ? "ppm" : extension);
+        if (!cv::imwrite(path, frame, params)) {
+            message = "Could not write frame " + path;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    std::string prefix;
+    std::string extension;
+    std::vector<int> params;
+};
+
+// 所有帧的像素依次写入一个文件或标准输出
+class RawStreamSink : public FrameSink {
+public:
+    explicit RawStreamSink(const std::string& path) : path(path) {
+        file = (path == "-") ? stdout : std::fopen(path.c_str(), "wb");
+#ifdef _WIN32
+        // 标准输出默认为文本模式，像素中的 0x0A 会被改写为 CRLF
+        if (file == stdout) {
+            _setmode(_fileno(stdout), _O_BINARY);
+        }
+#endif
+        if (!file) {
+            message = "Could not open " + path;
+        }
+    }
+
+    ~RawStreamSink() override {
+        close();
+    }
+
+    bool opened() const { return file != nullptr; }
+
+    bool write(uint32_t, const cv::Mat& frame) override {
+        size_t rowBytes = (size_t)frame.cols * frame.elemSize();
+        if (frame.isContinuous()) {
+            rowBytes *= frame.rows;
+        }
+        int rows = frame.isContinuous() ? 1 : frame.rows;
+        for (int y = 0; y < rows; ++y) {
+            if (std::fwrite(frame.ptr<uint8_t>(y), 1, rowBytes, file) != rowBytes) {
+                message = "Could not write to " + path;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool close() override {
+        if (!file) {
+            return true;
+        }
+        bool ok = (file == stdout) ? std::fflush(file) == 0 : std::fclose(file) == 0;
+        file = nullptr;
+        return ok;
+    }
+
+private:
+    std::string path;
+    std::FILE* file = nullptr;
+};
+
+// 所有帧写入一个 FFV1 无损视频
+class VideoSink : public FrameSink {
+public:
+    bool open(const std::string& path, cv::Size frameSize, bool color, double fps) {
+        writer.open(path, cv::VideoWriter::fourcc('F', 'F', 'V', '1'), fps, frameSize, color);
+        if (!writer.isOpened()) {
+            message = "Could not open FFV1 video " + path + " (backend without FFV1 support?)";
+            return false;
+        }
+        return true;
+    }
+
+    bool write(uint32_t, const cv::Mat& frame) override {
+        writer.write(frame);
+        return true;
+    }
+
+    bool close() override {
+        writer.release();
+        return true;
+    }
+
+private:
+    cv::VideoWriter writer;
+};
+
+// 按 spec 创建输出端：output 对 png / pgm 为文件名前缀，对 raw / video 为输出文件。
+// 打不开时返回空指针，原因写入 error
+inline std::unique_ptr<FrameSink> openFrameSink(const SinkSpec& spec, const std::string& output, cv::Size frameSize,
+    bool color, std::string& error) {
+    switch (spec.kind) {
+    case SINK_PNG:
+        return std::unique_ptr<FrameSink>(new ImageFileSink(output, "png", pngWriteParams(spec)));
+    case SINK_PGM:
+        return std::unique_ptr<FrameSink>(new ImageFileSink(output, "pgm", { cv::IMWRITE_PXM_BINARY, 1 }));
+    case SINK_RAW: {
+        std::unique_ptr<RawStreamSink> sink(new RawStreamSink(output));
+        if (!sink->opened()) {
+            error = sink->error();
+            return nullptr;
+        }
+        return sink;
+    }
+    case SINK_VIDEO: {
+        std::unique_ptr<VideoSink> sink(new VideoSink());
+        if (!sink->open(output, frameSize, color, spec.fps)) {
+            error = sink->error();
+            return nullptr;
+        }
+        return sink;
+    }
+    }
+    return nullptr;
+}
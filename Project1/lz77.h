@@ -0,0 +1,329 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+// 内置 LZ77 压缩（编码器与解码器共用，无外部依赖）：LZ4 风格的字节对齐序列，单次哈希查找、贪心匹配，
+// 偏重速度而非压缩率。数据流按 LZ_BLOCK_SIZE 切成块，各块独立压缩，压缩后不变短的块原样存放，
+// 随机数据最多只多出每块 8 字节的块头。
+// 压缩流为各块依次排列：块头 原始长度(4) + 存放长度(4，最高位为 1 表示压缩)，其后为块内容，多字节字段为大端。
+// 压缩块内为若干序列：令牌(1，高 4 位字面量长度，低 4 位匹配长度 - LZ_MIN_MATCH，取 15 时后接扩展字节，
+// 逐个累加直到某字节不为 255) + 字面量 + 匹配距离(2，大端) + 匹配长度扩展字节；最后一个序列只有字面量
+
+const size_t LZ_BLOCK_SIZE = 64 * 1024;
+const int LZ_BLOCK_HEADER_SIZE = 8;
+const uint32_t LZ_COMPRESSED_FLAG = 0x80000000u;
+const int LZ_MIN_MATCH = 4;
+const size_t LZ_MAX_DISTANCE = 65535;
+const int LZ_HASH_BITS = 14;
+
+inline uint32_t lzLoad32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, 4);
+    return value;
+}
+
+inline uint32_t lzHash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// 写出长度字段的扩展字节（令牌中的 4 位已记下 15）
+inline uint8_t* lzWriteLength(uint8_t* out, size_t length) {
+    for (length -= 15; length >= 255; length -= 255) {
+        *out++ = 255;
+    }
+    *out++ = (uint8_t)length;
+    return out;
+}
+
+// 单块压缩器：哈希表在对象内复用
+class LzCompressor {
+public:
+    LzCompressor() : table((size_t)1 << LZ_HASH_BITS) {}
+
+    // 压缩 src[0, n)（n <= LZ_BLOCK_SIZE）到 dst（容量至少 n）；结果不比输入短时返回 0（调用方原样存放）
+    size_t compress(const uint8_t* src, size_t n, uint8_t* dst) {
+        if (n < 2 * LZ_MIN_MATCH) {
+            return 0;
+        }
+        std::fill(table.begin(), table.end(), 0);
+        uint8_t* out = dst;
+        uint8_t* outEnd = dst + n;
+        size_t anchor = 0;
+        size_t pos = 0;
+        size_t misses = 0;
+        while (pos + LZ_MIN_MATCH <= n) {
+            uint32_t sequence = lzLoad32(src + pos);
+            uint32_t& slot = table[lzHash(sequence)];
+            size_t candidate = slot;
+            slot = (uint32_t)pos;
+            if (candidate >= pos || pos - candidate > LZ_MAX_DISTANCE || lzLoad32(src + candidate) != sequence) {
+                // 连续找不到匹配时逐渐加大步长，不可压缩的数据很快扫过
+                pos += 1 + (misses++ >> 5);
+                continue;
+            }
+            size_t length = LZ_MIN_MATCH;
+            while (pos + length < n && src[candidate + length] == src[pos + length]) {
+                length++;
+            }
+            out = writeSequence(out, outEnd, src + anchor, pos - anchor, pos - candidate, length);
+            if (!out) {
+                return 0;
+            }
+            pos += length;
+            anchor = pos;
+            misses = 0;
+        }
+        out = writeSequence(out, outEnd, src + anchor, n - anchor, 0, 0);
+        return out ? (size_t)(out - dst) : 0;
+    }
+
+private:
+    // 写出一个序列（length 为 0 时只有字面量），超出 outEnd 时返回空指针
+    static uint8_t* writeSequence(uint8_t* out, uint8_t* outEnd, const uint8_t* literals, size_t literalLength,
+        size_t distance, size_t length) {
+        // 令牌 + 两个长度字段的扩展字节 + 距离的上界
+        size_t bound = 1 + (literalLength / 255 + 1) + literalLength + 2 + (length / 255 + 1);
+        if ((size_t)(outEnd - out) < bound) {
+            return nullptr;
+        }
+        size_t matchCode = length ? length - LZ_MIN_MATCH : 0;
+        uint8_t* token = out++;
+        *token = (uint8_t)((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(matchCode, 15));
+        if (literalLength >= 15) {
+            out = lzWriteLength(out, literalLength);
+        }
+        memcpy(out, literals, literalLength);
+        out += literalLength;
+        if (length) {
+            *out++ = (uint8_t)(distance >> 8);
+            *out++ = (uint8_t)distance;
+            if (matchCode >= 15) {
+                out = lzWriteLength(out, matchCode);
+            }
+        }
+        return out;
+    }
+
+    std::vector<uint32_t> table;
+};
+
+// 读取长度字段的扩展字节
+inline bool lzReadLength(const uint8_t*& in, const uint8_t* end, size_t& length) {
+    uint8_t byte;
+    do {
+        if (in == end) {
+            return false;
+        }
+        byte = *in++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+// 解压一个压缩块到 dst（恰好 rawLength 字节）；数据损坏时返回 false，不会越界读写
+inline bool lzDecompress(const uint8_t* src, size_t n, uint8_t* dst, size_t rawLength) {
+    const uint8_t* in = src;
+    const uint8_t* end = src + n;
+    size_t out = 0;
+    while (in < end) {
+        uint8_t token = *in++;
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !lzReadLength(in, end, literalLength)) {
+            return false;
+        }
+        if (literalLength > (size_t)(end - in) || literalLength > rawLength - out) {
+            return false;
+        }
+        memcpy(dst + out, in, literalLength);
+        in += literalLength;
+        out += literalLength;
+        if (in == end) {
+            break;
+        }
+
+        if (end - in < 2) {
+            return false;
+        }
+        size_t distance = ((size_t)in[0] << 8) | in[1];
+        in += 2;
+        size_t length = token & 15;
+        if (length == 15 && !lzReadLength(in, end, length)) {
+            return false;
+        }
+        length += LZ_MIN_MATCH;
+        if (distance == 0 || distance > out || length > rawLength - out) {
+            return false;
+        }
+        // 距离小于长度时源与目标重叠，逐字节复制即为重复展开
+        const uint8_t* from = dst + out - distance;
+        if (distance >= length) {
+            memcpy(dst + out, from, length);
+        }
+        else {
+            for (size_t i = 0; i < length; ++i) {
+                dst[out + i] = from[i];
+            }
+        }
+        out += length;
+    }
+    return out == rawLength;
+}
+
+// 压缩流的编码端：构造时逐块压缩一遍，只记下各块的存放长度（得到压缩流总长和各块位置）；
+// read 时重新压缩被读到的块并缓存最近一块，顺序读取时每块只再压缩一次，内存占用与数据流长度无关。
+// retain 为 true 时第一遍就保留整个压缩流，read 只是复制：随机读取（喷泉码按需异或任意源符号）
+// 不必每次重新压缩一整块，代价是内存占用等于压缩流长度
+class LzStreamEncoder {
+public:
+    typedef std::function<void(size_t offset, size_t length, uint8_t* out)> SourceReader;
+
+    LzStreamEncoder(size_t length, SourceReader readSource, bool retain = false)
+        : length(length), readSource(readSource), source(LZ_BLOCK_SIZE), block(LZ_BLOCK_HEADER_SIZE + LZ_BLOCK_SIZE),
+        retain(retain) {
+        size_t blocks = (length + LZ_BLOCK_SIZE - 1) / LZ_BLOCK_SIZE;
+        blockStart.reserve(blocks + 1);
+        blockStart.push_back(0);
+        for (size_t i = 0; i < blocks; ++i) {
+            size_t stored = loadBlock(i);
+            blockStart.push_back(blockStart.back() + stored);
+            if (retain) {
+                retained.insert(retained.end(), block.begin(), block.begin() + stored);
+            }
+        }
+    }
+
+    // 压缩流总长
+    size_t size() const {
+        return (size_t)blockStart.back();
+    }
+
+    // 压缩后变短（按压缩存放）的块数；为 0 时压缩没有意义
+    size_t compressedBlocks() const {
+        return compressedCount;
+    }
+
+    void read(size_t offset, size_t count, uint8_t* out) {
+        if (retain) {
+            memcpy(out, retained.data() + offset, count);
+            return;
+        }
+        while (count > 0) {
+            // 所在块：blockStart 中最后一个不大于 offset 的位置
+            size_t index = (size_t)(std::upper_bound(blockStart.begin(), blockStart.end(), (uint64_t)offset) -
+                blockStart.begin()) - 1;
+            if (index != cachedBlock) {
+                loadBlock(index);
+            }
+            size_t inBlock = offset - (size_t)blockStart[index];
+            size_t n = std::min(count, (size_t)(blockStart[index + 1] - blockStart[index]) - inBlock);
+            memcpy(out, block.data() + inBlock, n);
+            out += n;
+            offset += n;
+            count -= n;
+        }
+    }
+
+private:
+    // 生成第 index 块（块头 + 内容）到 block，返回其字节数
+    size_t loadBlock(size_t index) {
+        size_t offset = index * LZ_BLOCK_SIZE;
+        size_t raw = std::min(LZ_BLOCK_SIZE, length - offset);
+        readSource(offset, raw, source.data());
+        uint8_t* payload = block.data() + LZ_BLOCK_HEADER_SIZE;
+        size_t packed = compressor.compress(source.data(), raw, payload);
+        uint32_t stored = (uint32_t)packed | LZ_COMPRESSED_FLAG;
+        if (packed == 0) {
+            memcpy(payload, source.data(), raw);
+            stored = (uint32_t)raw;
+        }
+        else if (blockStart.size() <= index + 1) {
+            compressedCount++;   // 第一遍
+        }
+        for (int i = 0; i < 4; ++i) {
+            block[i] = (uint8_t)(raw >> (24 - 8 * i));
+            block[4 + i] = (uint8_t)(stored >> (24 - 8 * i));
+        }
+        cachedBlock = index;
+        return LZ_BLOCK_HEADER_SIZE + (stored & ~LZ_COMPRESSED_FLAG);
+    }
+
+    size_t length;
+    SourceReader readSource;
+    LzCompressor compressor;
+    std::vector<uint8_t> source;
+    std::vector<uint8_t> block;
+    std::vector<uint64_t> blockStart;   // 各块在压缩流中的起点（末项为总长）
+    size_t cachedBlock = SIZE_MAX;
+    size_t compressedCount = 0;
+    bool retain = false;
+    std::vector<uint8_t> retained;   // retain 时的整个压缩流
+};
+
+// 压缩流的解码端：逐块从 read 取得压缩流（每次请求 n 字节，取不到时返回 false），解压后交给 write。
+// 压缩流不完整或损坏时返回 false
+inline bool lzDecodeStream(const std::function<bool(uint8_t* out, size_t n)>& read, uint64_t length,
+    const std::function<void(const uint8_t* data, size_t n)>& write) {
+    std::vector<uint8_t> packed(LZ_BLOCK_SIZE);
+    std::vector<uint8_t> raw(LZ_BLOCK_SIZE);
+    uint8_t header[LZ_BLOCK_HEADER_SIZE];
+    for (uint64_t consumed = 0; consumed < length; ) {
+        if (length - consumed < LZ_BLOCK_HEADER_SIZE || !read(header, LZ_BLOCK_HEADER_SIZE)) {
+            return false;
+        }
+        uint32_t rawLength = (uint32_t(header[0]) << 24) | (uint32_t(header[1]) << 16) | (uint32_t(header[2]) << 8) | header[3];
+        uint32_t stored = (uint32_t(header[4]) << 24) | (uint32_t(header[5]) << 16) | (uint32_t(header[6]) << 8) | header[7];
+        bool compressed = (stored & LZ_COMPRESSED_FLAG) != 0;
+        stored &= ~LZ_COMPRESSED_FLAG;
+        consumed += LZ_BLOCK_HEADER_SIZE;
+        if (rawLength == 0 || rawLength > LZ_BLOCK_SIZE || stored > length - consumed ||
+            (compressed ? stored >= rawLength : stored != rawLength)) {
+            return false;
+        }
+        if (!read(packed.data(), stored)) {
+            return false;
+        }
+        consumed += stored;
+        if (!compressed) {
+            write(packed.data(), stored);
+        }
+        else if (lzDecompress(packed.data(), stored, raw.data(), rawLength)) {
+            write(raw.data(), rawLength);
+        }
+        else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 整段数据压缩为压缩流（单张图像模式）
+inline std::vector<uint8_t> lzCompressBuffer(const std::vector<uint8_t>& data, size_t* compressedBlocks = nullptr) {
+    LzStreamEncoder encoder(data.size(), [&data](size_t offset, size_t length, uint8_t* out) {
+        memcpy(out, data.data() + offset, length);
+    }, true);
+    std::vector<uint8_t> stream(encoder.size());
+    encoder.read(0, stream.size(), stream.data());
+    if (compressedBlocks) {
+        *compressedBlocks = encoder.compressedBlocks();
+    }
+    return stream;
+}
+
+inline bool lzDecompressBuffer(const std::vector<uint8_t>& stream, std::vector<uint8_t>& data) {
+    size_t pos = 0;
+    data.clear();
+    return lzDecodeStream(
+        [&](uint8_t* out, size_t n) {
+            memcpy(out, stream.data() + pos, n);
+            pos += n;
+            return true;
+        },
+        stream.size(),
+        [&data](const uint8_t* bytes, size_t n) { data.insert(data.end(), bytes, bytes + n); });
+}
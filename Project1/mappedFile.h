@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// 只读内存映射文件（编码器输入）：按需分页读入，不把整个文件复制到内存；
+// release 把已处理完的范围移出进程工作集（页面仍在系统缓存中），顺序处理大文件时驻留内存保持不变
+class MappedFile {
+public:
+    static const size_t PAGE_BYTES = 4096;
+
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        close();
+    }
+
+    // 空文件也视为打开成功（data() 为空指针）
+    bool open(const std::string& path) {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize)) {
+            close();
+            return false;
+        }
+        length = (size_t)fileSize.QuadPart;
+        if (length > 0) {
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            view = mapping ? (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+            if (!view) {
+                close();
+                return false;
+            }
+        }
+#else
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close();
+            return false;
+        }
+        length = (size_t)st.st_size;
+        if (length > 0) {
+            void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address == MAP_FAILED) {
+                close();
+                return false;
+            }
+            view = (const uint8_t*)address;
+            madvise(address, length, MADV_SEQUENTIAL);
+        }
+#endif
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (view) {
+            UnmapViewOfFile(view);
+        }
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+        }
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (view) {
+            munmap((void*)view, length);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        fd = -1;
+#endif
+        view = nullptr;
+        length = 0;
+    }
+
+    const uint8_t* data() const {
+        return view;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+    // 不再访问 [offset, offset + count)：其中完整的页面移出工作集
+    void release(size_t offset, size_t count) {
+        if (!view || count == 0) {
+            return;
+        }
+        size_t begin = (offset + PAGE_BYTES - 1) / PAGE_BYTES * PAGE_BYTES;
+        size_t end = (offset + count) / PAGE_BYTES * PAGE_BYTES;
+        if (end <= begin) {
+            return;
+        }
+#ifdef _WIN32
+        // 对未锁定的页面调用 VirtualUnlock 会把它们移出工作集
+        VirtualUnlock((LPVOID)(view + begin), end - begin);
+#else
+        madvise((void*)(view + begin), end - begin, MADV_DONTNEED);
+#endif
+    }
+
+private:
+    const uint8_t* view = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// 运行指标与分级日志。
+//
+// 日志分三级：LOG_QUIET 只输出错误，LOG_SUMMARY 输出每次运行的摘要（默认），LOG_DETAIL 输出逐帧、逐字节的明细。
+// QRCODEC_LOG_LEVEL 为编译期上限（默认 LOG_SUMMARY），高于上限的 QRCODEC_LOG 语句连同参数求值一起被编译器删去，
+// 热循环里的明细日志只存在于 -DQRCODEC_LOG_LEVEL=2 的构建中；运行期可再用 setLogLevel 降低级别（--quiet）
+//
+// 指标默认关闭，此时计时与计数都只是一次分支；enable 后 ScopedTimer 按级累计耗时和调用次数，
+// count 累加计数器，运行结束时由 writeJson 一次输出。各级独立累计，可以嵌套（如 verify 含 crc）；
+// 流水线的各级在不同线程中并发累计，各级耗时之和可能超过墙钟时间
+
+#ifndef QRCODEC_LOG_LEVEL
+#define QRCODEC_LOG_LEVEL 1
+#endif
+
+enum LogLevel {
+    LOG_QUIET = 0,
+    LOG_SUMMARY = 1,
+    LOG_DETAIL = 2
+};
+
+struct LogConfig {
+    int level = LOG_SUMMARY;
+    std::ostream* stream = &std::cout;
+};
+
+inline LogConfig& logConfig() {
+    static LogConfig config;
+    return config;
+}
+
+inline void setLogLevel(int level) {
+    logConfig().level = level;
+}
+
+// 日志输出流（默认标准输出）
+inline void setLogStream(std::ostream& stream) {
+    logConfig().stream = &stream;
+}
+
+inline bool logEnabled(int level) {
+    return level <= logConfig().level;
+}
+
+// 用法：QRCODEC_LOG(LOG_SUMMARY, "Frames: " << count);
+#define QRCODEC_LOG(level, message) \
+    do { \
+        if ((level) <= QRCODEC_LOG_LEVEL && logEnabled(level)) { \
+            *logConfig().stream << message << std::endl; \
+        } \
+    } while (0)
+
+// 计时的处理级
+enum MetricStage {
+    STAGE_READ,      // 读取输入数据
+    STAGE_CRC,       // CRC32 计算
+    STAGE_FEC,       // RS 编码 / 纠错（奇偶校验模式为按组解码）
+    STAGE_PACK,      // 字节打包为比特流
+    STAGE_RASTER,    // 模块网格绘制与光栅化
+    STAGE_IMWRITE,   // 帧图像写出
+    STAGE_IMREAD,    // 帧图像读入（含视频解码）
+    STAGE_LOCATE,    // 定位与读取帧描述区
+    STAGE_SAMPLE,    // 数据模块采样
+    STAGE_VERIFY,    // 整体校验码验证（含回读）
+    STAGE_COMPRESS,  // LZ77 压缩 / 解压（含其中的读取）
+    STAGE_COUNT
+};
+
+const char* const STAGE_NAMES[STAGE_COUNT] = {
+    "read", "crc", "fec", "pack", "raster", "imwrite", "imread", "locate", "sample", "verify", "compress"
+};
+
+// 计数器
+enum MetricCounter {
+    COUNTER_FRAMES,              // 编码或成功纠错的帧数
+    COUNTER_PARITY_ERRORS,       // 奇偶校验不符的字节数
+    COUNTER_CORRECTED_SYMBOLS,   // RS 纠正的符号数
+    COUNTER_ERASURES,            // 作为擦除交给 RS 的字节数
+    COUNTER_FAILED_BLOCKS,       // 无法纠正的 RS 码字数
+    COUNTER_LOW_VALIDITY,        // 有效性不低于擦除阈值的模块数
+    COUNTER_FUSED_FRAMES,        // 融合多次采集后才纠错成功的帧数
+    COUNTER_COUNT
+};
+
+const char* const COUNTER_NAMES[COUNTER_COUNT] = {
+    "frames", "parity_errors", "corrected_symbols", "erasures", "failed_blocks", "low_validity_modules",
+    "fused_frames"
+};
+
+class Metrics {
+public:
+    // 在启动工作线程之前调用
+    void enable() {
+        on = true;
+        started = std::chrono::steady_clock::now();
+    }
+
+    bool enabled() const { return on; }
+
+    void addTime(MetricStage stage, uint64_t nanoseconds) {
+        stageNanoseconds[stage].fetch_add(nanoseconds, std::memory_order_relaxed);
+        stageCalls[stage].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void count(MetricCounter counter, uint64_t n = 1) {
+        if (on) {
+            counters[counter].fetch_add(n, std::memory_order_relaxed);
+        }
+    }
+
+    // 一行 JSON：{"tool":..., "wall_ms":..., "stages":{"read":{"calls":N,"ms":T},...}, "counters":{...}}
+    void writeJson(std::ostream& out, const char* tool) const {
+        double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        out << "{\"tool\":\"" << tool << "\",\"wall_ms\":" << wallMs << ",\"stages\":{";
+        for (int i = 0; i < STAGE_COUNT; ++i) {
+            out << (i ? "," : "") << "\"" << STAGE_NAMES[i] << "\":{\"calls\":"
+                << stageCalls[i].load(std::memory_order_relaxed) << ",\"ms\":"
+                << stageNanoseconds[i].load(std::memory_order_relaxed) / 1e6 << "}";
+        }
+        out << "},\"counters\":{";
+        for (int i = 0; i < COUNTER_COUNT; ++i) {
+            out << (i ? "," : "") << "\"" << COUNTER_NAMES[i] << "\":" << counters[i].load(std::memory_order_relaxed);
+        }
+        out << "}}" << std::endl;
+    }
+
+private:
+    bool on = false;
+    std::chrono::steady_clock::time_point started;
+    std::atomic<uint64_t> stageNanoseconds[STAGE_COUNT] = {};
+    std::atomic<uint64_t> stageCalls[STAGE_COUNT] = {};
+    std::atomic<uint64_t> counters[COUNTER_COUNT] = {};
+};
+
+// 进程内唯一的指标实例
+inline Metrics& metrics() {
+    static Metrics instance;
+    return instance;
+}
+
+// 作用域计时：析构时把经过的时间累计到 stage（指标关闭时不读时钟）
+class ScopedTimer {
+public:
+    explicit ScopedTimer(MetricStage stage) : stage(stage), active(metrics().enabled()) {
+        if (active) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ScopedTimer() {
+        if (active) {
+            metrics().addTime(stage, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count());
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    MetricStage stage;
+    bool active;
+    std::chrono::steady_clock::time_point start;
+};
+
+// 把指标摘要写到 path（"-" 为标准输出），命令行的 --metrics 选项使用
+inline bool writeMetricsFile(const std::string& path, const char* tool) {
+    if (path == "-") {
+        metrics().writeJson(std::cout, tool);
+        return true;
+    }
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    metrics().writeJson(out, tool);
+    return (bool)out;
+}
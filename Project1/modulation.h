@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <cfloat>
+
+// 多电平调制：每模块 bitsPerModule 比特，编码器与解码器共用
+//   1 = 黑白（黑 = 1），单通道
+//   2 = 4 级灰度（符号 0..3 依次为白、浅灰、深灰、黑），单通道
+//   3 = 8 色（符号的 3 个比特从低位起依次对应 B、G、R 通道是否点亮，0 = 黑，7 = 白），三通道
+const int MAX_BITS_PER_MODULE = 3;
+
+inline int modulationLevels(int bitsPerModule) {
+    return 1 << bitsPerModule;
+}
+
+inline int modulationChannels(int bitsPerModule) {
+    return (bitsPerModule == 3) ? 3 : 1;
+}
+
+// 校准色块数：黑白模式不需要
+inline int calibrationLevels(int bitsPerModule) {
+    return (bitsPerModule > 1) ? modulationLevels(bitsPerModule) : 0;
+}
+
+// 单通道模式下符号对应的灰度
+inline uint8_t symbolGray(int symbol, int bitsPerModule) {
+    if (bitsPerModule == 1) {
+        return symbol ? 0 : 255;
+    }
+    return (uint8_t)(255 - symbol * 255 / (modulationLevels(bitsPerModule) - 1));
+}
+
+// 8 色模式下符号对应的 BGR 颜色
+inline void symbolColor(int symbol, uint8_t bgr[3]) {
+    bgr[0] = (symbol & 1) ? 255 : 0;
+    bgr[1] = (symbol & 2) ? 255 : 0;
+    bgr[2] = (symbol & 4) ? 255 : 0;
+}
+
+// 解码端的电平校准：由帧内校准色块的实测均值作为各电平的中心，按最近中心分类
+struct LevelCalibration {
+    int levels = 0;
+    int channels = 1;
+    float centers[8][3] = {};
+
+    // 分类一个像素（channels 个字节），返回符号；ambiguity 为不可靠程度
+    // （最近与次近中心距离之比，0 = 恰好落在中心，255 = 位于两中心正中间）
+    int classify(const uint8_t* pixel, uint8_t& ambiguity) const {
+        float best = FLT_MAX, second = FLT_MAX;
+        int symbol = 0;
+        for (int level = 0; level < levels; ++level) {
+            float distance = 0;
+            for (int c = 0; c < channels; ++c) {
+                float d = pixel[c] - centers[level][c];
+                distance += d * d;
+            }
+            if (distance < best) {
+                second = best;
+                best = distance;
+                symbol = level;
+            }
+            else if (distance < second) {
+                second = distance;
+            }
+        }
+        float ratio = (best + second > 0) ? best / (best + second) : 0;
+        ambiguity = (uint8_t)(ratio * 510 > 255 ? 255 : ratio * 510);
+        return symbol;
+    }
+};
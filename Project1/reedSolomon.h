@@ -0,0 +1,421 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+// GF(256) 上的 Reed-Solomon 码 RS(255, k)，编码器与解码器共用
+// 本原多项式 x^8 + x^4 + x^3 + x^2 + 1 (0x11D)，生成元 α = 2，生成多项式根为 α^0 .. α^(nsym-1)
+// 码字为系统码：前 k 字节为数据，后 nsym = 255 - k 字节为校验；允许缩短码（n < 255）
+
+const int RS_BLOCK_SIZE = 255;
+
+struct GaloisField {
+    uint8_t exp[512];
+    uint8_t log[256];
+
+    GaloisField() {
+        int x = 1;
+        for (int i = 0; i < 255; ++i) {
+            exp[i] = (uint8_t)x;
+            log[x] = (uint8_t)i;
+            x <<= 1;
+            if (x & 0x100) {
+                x ^= 0x11D;
+            }
+        }
+        for (int i = 255; i < 512; ++i) {
+            exp[i] = exp[i - 255];
+        }
+        log[0] = 0;
+    }
+
+    uint8_t mul(uint8_t a, uint8_t b) const {
+        return (a == 0 || b == 0) ? 0 : exp[log[a] + log[b]];
+    }
+
+    uint8_t div(uint8_t a, uint8_t b) const {
+        return (a == 0) ? 0 : exp[log[a] + 255 - log[b]];
+    }
+
+    // α^power，power 可以为负
+    uint8_t pow(int power) const {
+        power %= 255;
+        return exp[power < 0 ? power + 255 : power];
+    }
+};
+
+inline const GaloisField& galoisField() {
+    static const GaloisField field;
+    return field;
+}
+
+class ReedSolomon {
+public:
+    explicit ReedSolomon(int paritySymbols) : nsym(paritySymbols), gf(galoisField()) {
+        // g(x) = (x - α^0)(x - α^1)...(x - α^(nsym-1))，系数按降幂排列
+        generator.assign(1, 1);
+        for (int i = 0; i < nsym; ++i) {
+            std::vector<uint8_t> next(generator.size() + 1, 0);
+            for (size_t j = 0; j < generator.size(); ++j) {
+                next[j] ^= generator[j];
+                next[j + 1] ^= gf.mul(generator[j], gf.pow(i));
+            }
+            generator.swap(next);
+        }
+    }
+
+    int paritySymbols() const { return nsym; }
+
+    // 计算 length 字节数据的校验字节，写入 parity[0 .. nsym)
+    void encode(const uint8_t* data, int length, uint8_t* parity) const {
+        memset(parity, 0, nsym);
+        for (int i = 0; i < length; ++i) {
+            uint8_t feedback = data[i] ^ parity[0];
+            memmove(parity, parity + 1, nsym - 1);
+            parity[nsym - 1] = 0;
+            if (feedback != 0) {
+                uint8_t logFeedback = gf.log[feedback];
+                for (int j = 0; j < nsym; ++j) {
+                    if (generator[j + 1] != 0) {
+                        parity[j] ^= gf.exp[logFeedback + gf.log[generator[j + 1]]];
+                    }
+                }
+            }
+        }
+    }
+
+    // 原地纠正长度为 length 的码字，erasures 为已知不可靠的字节位置（擦除），可为空
+    // e 个擦除和 t 个未知错误满足 e + 2t <= nsym 时可以纠正
+    // 返回实际修改的符号数；无法纠正时返回 -1（码字保持不变）
+    int decode(uint8_t* codeword, int length, const std::vector<int>& erasures = std::vector<int>()) const {
+        std::vector<uint8_t> syndromes(nsym);
+        if (!computeSyndromes(codeword, length, syndromes)) {
+            return 0;
+        }
+        int erasureCount = (int)erasures.size();
+        if (erasureCount > nsym) {
+            return -1;
+        }
+
+        if (erasureCount == 0) {
+            std::vector<uint8_t> locator;
+            if (!findErrorLocator(syndromes, nsym, locator)) {
+                return -1;
+            }
+            return correctErrata(codeword, length, syndromes, locator);
+        }
+
+        // 擦除位置多项式 Γ(x) = Π(1 + X_k x)，X_k = α^(length-1-p)
+        std::vector<uint8_t> erasureLocator(1, 1);
+        for (int position : erasures) {
+            uint8_t x = gf.pow(length - 1 - position);
+            erasureLocator.push_back(0);
+            for (size_t i = erasureLocator.size() - 1; i > 0; --i) {
+                erasureLocator[i] ^= gf.mul(erasureLocator[i - 1], x);
+            }
+        }
+
+        // Forney 伴随式：消去擦除的影响后，用剩余的 nsym - e 个伴随式求未知错误的位置
+        std::vector<uint8_t> forney = syndromes;
+        for (int position : erasures) {
+            uint8_t x = gf.pow(length - 1 - position);
+            for (int j = 0; j < nsym - 1; ++j) {
+                forney[j] = gf.mul(forney[j], x) ^ forney[j + 1];
+            }
+        }
+
+        std::vector<uint8_t> errorLocator;
+        if (!findErrorLocator(forney, nsym - erasureCount, errorLocator)) {
+            return -1;
+        }
+
+        // 错误与擦除合并的位置多项式 Λ(x) = 错误位置多项式 · Γ(x)
+        std::vector<uint8_t> locator(errorLocator.size() + erasureLocator.size() - 1, 0);
+        for (size_t i = 0; i < errorLocator.size(); ++i) {
+            for (size_t j = 0; j < erasureLocator.size(); ++j) {
+                locator[i + j] ^= gf.mul(errorLocator[i], erasureLocator[j]);
+            }
+        }
+        return correctErrata(codeword, length, syndromes, locator);
+    }
+
+protected:
+    // Berlekamp-Massey：由前 count 个伴随式求错误位置多项式 Λ(x)（升幂排列），错误过多时返回 false
+    bool findErrorLocator(const std::vector<uint8_t>& syndromes, int count, std::vector<uint8_t>& locator) const {
+        std::vector<uint8_t> previous(1, 1);
+        locator.assign(1, 1);
+        int errors = 0;
+        int shift = 1;
+        uint8_t lastDiscrepancy = 1;
+        for (int r = 0; r < count; ++r) {
+            uint8_t discrepancy = syndromes[r];
+            for (int i = 1; i <= errors && i < (int)locator.size(); ++i) {
+                discrepancy ^= gf.mul(locator[i], syndromes[r - i]);
+            }
+            if (discrepancy == 0) {
+                shift++;
+                continue;
+            }
+
+            std::vector<uint8_t> updated = locator;
+            uint8_t scale = gf.div(discrepancy, lastDiscrepancy);
+            if (updated.size() < previous.size() + shift) {
+                updated.resize(previous.size() + shift, 0);
+            }
+            for (size_t i = 0; i < previous.size(); ++i) {
+                updated[i + shift] ^= gf.mul(scale, previous[i]);
+            }
+
+            if (2 * errors <= r) {
+                previous = locator;
+                errors = r + 1 - errors;
+                lastDiscrepancy = discrepancy;
+                shift = 1;
+            }
+            else {
+                shift++;
+            }
+            locator.swap(updated);
+        }
+        locator.resize(errors + 1);
+        return 2 * errors <= count;
+    }
+
+    // 计算伴随式 S_i = c(α^i)，全为 0 时返回 false
+    bool computeSyndromes(const uint8_t* codeword, int length, std::vector<uint8_t>& syndromes) const {
+        bool nonZero = false;
+        for (int i = 0; i < nsym; ++i) {
+            uint8_t s = 0;
+            if (i == 0) {
+                for (int j = 0; j < length; ++j) {
+                    s ^= codeword[j];
+                }
+            }
+            else {
+                for (int j = 0; j < length; ++j) {
+                    s = (s == 0) ? codeword[j] : (gf.exp[gf.log[s] + i] ^ codeword[j]);
+                }
+            }
+            syndromes[i] = s;
+            nonZero = nonZero || (s != 0);
+        }
+        return nonZero;
+    }
+
+    // 由错误位置多项式做 Chien 搜索和 Forney 算法，原地纠正并复核伴随式
+    int correctErrata(uint8_t* codeword, int length, const std::vector<uint8_t>& syndromes,
+        const std::vector<uint8_t>& locator) const {
+        int degree = (int)locator.size() - 1;
+
+        // Ω(x) = S(x)Λ(x) mod x^nsym
+        std::vector<uint8_t> evaluator(nsym, 0);
+        for (int i = 0; i < nsym; ++i) {
+            for (int j = 0; j <= degree && j <= i; ++j) {
+                evaluator[i] ^= gf.mul(locator[j], syndromes[i - j]);
+            }
+        }
+
+        // Chien 搜索：位置 j 对应 X = α^(length-1-j)，满足 Λ(X^-1) = 0
+        std::vector<int> positions;
+        std::vector<uint8_t> magnitudes;
+        for (int j = 0; j < length; ++j) {
+            int power = length - 1 - j;
+            uint8_t xInverse = gf.pow(-power);
+            if (evaluate(locator, xInverse) != 0) {
+                continue;
+            }
+
+            // Forney：e = X · Ω(X^-1) / Λ'(X^-1)，Λ' 在特征 2 下只保留奇次项
+            uint8_t derivative = 0;
+            for (int i = 1; i <= degree; i += 2) {
+                derivative ^= gf.mul(locator[i], gf.pow(-power * (i - 1)));
+            }
+            if (derivative == 0) {
+                return -1;
+            }
+            uint8_t magnitude = gf.mul(gf.pow(power), gf.div(evaluate(evaluator, xInverse), derivative));
+            positions.push_back(j);
+            magnitudes.push_back(magnitude);
+        }
+        if ((int)positions.size() != degree) {
+            return -1;
+        }
+
+        for (size_t i = 0; i < positions.size(); ++i) {
+            codeword[positions[i]] ^= magnitudes[i];
+        }
+
+        // 复核：纠正后的伴随式必须全为 0，否则撤销修改
+        std::vector<uint8_t> check(nsym);
+        if (computeSyndromes(codeword, length, check)) {
+            for (size_t i = 0; i < positions.size(); ++i) {
+                codeword[positions[i]] ^= magnitudes[i];
+            }
+            return -1;
+        }
+        return (int)(magnitudes.size() - std::count(magnitudes.begin(), magnitudes.end(), 0));
+    }
+
+    // 计算升幂多项式在 x 处的值
+    uint8_t evaluate(const std::vector<uint8_t>& poly, uint8_t x) const {
+        uint8_t result = 0;
+        for (int i = (int)poly.size() - 1; i >= 0; --i) {
+            result = gf.mul(result, x) ^ poly[i];
+        }
+        return result;
+    }
+
+    int nsym;
+    const GaloisField& gf;
+    std::vector<uint8_t> generator;
+};
+
+// 帧内分组与交织：一帧的 rawBytes 个字节按 255 字节一组切分为码字（最后一组可缩短），
+// 各码字的第 j 个字节依次相邻存放，使连续损坏的模块分散到不同码字中
+
+// 一帧可以承载的数据字节数（不含校验）
+inline size_t rsFrameCapacity(size_t rawBytes, int nsym) {
+    size_t full = rawBytes / RS_BLOCK_SIZE;
+    size_t rest = rawBytes % RS_BLOCK_SIZE;
+    return full * (RS_BLOCK_SIZE - nsym) + (rest > (size_t)nsym ? rest - nsym : 0);
+}
+
+// 承载 dataBytes 字节数据所需的最短编码长度（各码字依次填满，最后一个缩短），
+// 以此为 rawBytes 时 rsFrameCapacity 恰为 dataBytes
+inline size_t rsEncodedSize(size_t dataBytes, int nsym) {
+    size_t blockData = RS_BLOCK_SIZE - nsym;
+    return dataBytes + (dataBytes + blockData - 1) / blockData * nsym;
+}
+
+// 各码字长度（含校验）
+inline std::vector<int> rsBlockLengths(size_t rawBytes, int nsym) {
+    std::vector<int> lengths(rawBytes / RS_BLOCK_SIZE, RS_BLOCK_SIZE);
+    size_t rest = rawBytes % RS_BLOCK_SIZE;
+    if (rest > (size_t)nsym) {
+        lengths.push_back((int)rest);
+    }
+    return lengths;
+}
+
+// 按列交织：依次取各码字的第 0 字节、第 1 字节……
+template <typename Visit>
+inline void rsForEachInterleaved(const std::vector<int>& lengths, Visit visit) {
+    size_t pos = 0;
+    for (int j = 0; j < RS_BLOCK_SIZE; ++j) {
+        for (size_t block = 0; block < lengths.size(); ++block) {
+            if (j < lengths[block]) {
+                visit(block, j, pos++);
+            }
+        }
+    }
+}
+
+// 逐帧编码器：生成多项式和各码字的工作区在对象内复用，连续编码多帧时不再重新分配
+class RsFrameEncoder {
+public:
+    explicit RsFrameEncoder(int nsym) : nsym(nsym), rs(nsym) {}
+
+    // 编码一帧：data 不足容量时补 0，输出 rawBytes 字节的交织码字
+    void encode(const uint8_t* data, size_t length, size_t rawBytes, std::vector<uint8_t>& raw) {
+        if (rawBytes != lengthsFor) {
+            lengths = rsBlockLengths(rawBytes, nsym);
+            lengthsFor = rawBytes;
+        }
+        blocks.assign(lengths.size() * RS_BLOCK_SIZE, 0);
+
+        size_t offset = 0;
+        for (size_t block = 0; block < lengths.size(); ++block) {
+            int dataLength = lengths[block] - nsym;
+            uint8_t* codeword = &blocks[block * RS_BLOCK_SIZE];
+            if (offset < length) {
+                size_t n = std::min((size_t)dataLength, length - offset);
+                memcpy(codeword, data + offset, n);
+            }
+            rs.encode(codeword, dataLength, codeword + dataLength);
+            offset += dataLength;
+        }
+
+        raw.assign(rawBytes, 0);
+        rsForEachInterleaved(lengths, [&](size_t block, int j, size_t pos) {
+            raw[pos] = blocks[block * RS_BLOCK_SIZE + j];
+        });
+    }
+
+private:
+    int nsym;
+    ReedSolomon rs;
+    std::vector<int> lengths;
+    size_t lengthsFor = (size_t)-1;
+    std::vector<uint8_t> blocks;
+};
+
+inline std::vector<uint8_t> rsEncodeFrame(const std::vector<uint8_t>& data, size_t rawBytes, int nsym) {
+    std::vector<uint8_t> raw;
+    RsFrameEncoder(nsym).encode(data.data(), data.size(), rawBytes, raw);
+    return raw;
+}
+
+// 纠错统计
+struct RsDecodeStats {
+    size_t correctedSymbols = 0;
+    size_t erasures = 0;
+    size_t failedBlocks = 0;
+};
+
+// 解码一帧：解交织后逐码字纠错，返回数据字节
+// ambiguity 为每个字节的不可靠程度（可为空，0 = 完全可靠），不小于 erasureThreshold 的字节作为擦除
+// 交给 RS 译码；erasureThreshold 为 0 时不使用擦除；带擦除译码失败时退回仅纠错译码
+// 每个码字最多取最不可靠的 nsym - 4 个擦除，保留几个伴随式用于发现擦除以外的错误，
+// 否则擦除数达到 nsym 时任何码字都会被“纠正”成功
+inline std::vector<uint8_t> rsDecodeFrame(const std::vector<uint8_t>& raw, int nsym,
+    const std::vector<uint8_t>& ambiguity, int erasureThreshold, RsDecodeStats& stats) {
+    ReedSolomon rs(nsym);
+    std::vector<int> lengths = rsBlockLengths(raw.size(), nsym);
+    std::vector<std::vector<uint8_t>> blocks(lengths.size());
+    std::vector<std::vector<std::pair<int, int>>> candidates(lengths.size());
+    for (size_t block = 0; block < lengths.size(); ++block) {
+        blocks[block].resize(lengths[block]);
+    }
+    bool useErasures = !ambiguity.empty() && erasureThreshold > 0;
+    rsForEachInterleaved(lengths, [&](size_t block, int j, size_t pos) {
+        blocks[block][j] = raw[pos];
+        if (useErasures && ambiguity[pos] >= erasureThreshold) {
+            // 取负值，使排序后最不可靠的字节在前
+            candidates[block].push_back(std::make_pair(-int(ambiguity[pos]), j));
+        }
+    });
+
+    int maxErasures = (nsym > 8) ? nsym - 4 : nsym / 2;
+    std::vector<uint8_t> data;
+    data.reserve(rsFrameCapacity(raw.size(), nsym));
+    std::vector<int> erasures;
+    for (size_t block = 0; block < lengths.size(); ++block) {
+        std::vector<std::pair<int, int>>& list = candidates[block];
+        if ((int)list.size() > maxErasures) {
+            std::partial_sort(list.begin(), list.begin() + maxErasures, list.end());
+            list.resize(maxErasures);
+        }
+        erasures.clear();
+        for (const auto& candidate : list) {
+            erasures.push_back(candidate.second);
+        }
+
+        int result = rs.decode(blocks[block].data(), lengths[block], erasures);
+        if (result < 0 && !erasures.empty()) {
+            erasures.clear();
+            result = rs.decode(blocks[block].data(), lengths[block]);
+        }
+        if (result < 0) {
+            stats.failedBlocks++;
+        }
+        else {
+            stats.correctedSymbols += result;
+            stats.erasures += erasures.size();
+        }
+        data.insert(data.end(), blocks[block].begin(), blocks[block].end() - nsym);
+    }
+    return data;
+}
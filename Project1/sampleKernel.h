@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+
+// AVX2 路径按运行时检测选用（见 sampleKernelCpuHasAvx2），不要求以 -mavx2 / /arch:AVX2 编译
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SAMPLE_KERNEL_AVX2 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SAMPLE_KERNEL_TARGET_AVX2
+#else
+#define SAMPLE_KERNEL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SAMPLE_KERNEL_SSE2 1
+#endif
+
+// 3x3 采样核：对模块中心及其周围 8 个点（间距 MODULE_SIZE / 3）投票，
+// 黑色（< 128）计 1 票，得到比特有效性
+
+// 由投票数计算有效性 (0-255)，与原 calculateBitValidity 的浮点公式完全相同
+inline uint8_t validityFromVotes(int vote, int total) {
+    if (total == 0) return 0;
+    double consistency = 1.0 - (2.0 * abs(vote - total / 2.0) / total);
+    return static_cast<uint8_t>(consistency * 255);
+}
+
+// 9 个采样点全部有效时的查找表，热循环中只做整数查表
+struct ValidityTable {
+    uint8_t value[10];
+
+    ValidityTable() {
+        for (int vote = 0; vote <= 9; ++vote) {
+            value[vote] = validityFromVotes(vote, 9);
+        }
+    }
+};
+
+inline const ValidityTable& validityTable() {
+    static const ValidityTable table;
+    return table;
+}
+
+#ifdef SAMPLE_KERNEL_AVX2
+// 运行时检测 CPU 与操作系统是否支持 AVX2（操作系统须保存 YMM 寄存器）
+inline bool sampleKernelCpuHasAvx2() {
+    static const bool supported = [] {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) {
+            return false;
+        }
+        __cpuid(info, 1);
+        bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+        __cpuidex(info, 7, 0);
+        return osSavesYmm && (info[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    }();
+    return supported;
+}
+
+// columnVotes 的 AVX2 部分：一次处理 32 列，返回处理到的列
+SAMPLE_KERNEL_TARGET_AVX2
+inline int columnVotesAvx2(const uint8_t* above, const uint8_t* center, const uint8_t* below,
+    int width, uint8_t* votes) {
+    const __m256i three = _mm256_set1_epi8(3);
+    const __m256i zero = _mm256_setzero_si256();
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        // 白色像素比较结果为 -1，三行相加后 3 + sum 即黑色像素数
+        __m256i a = _mm256_cmpgt_epi8(zero, _mm256_loadu_si256((const __m256i*)(above + x)));
+        __m256i b = _mm256_cmpgt_epi8(zero, _mm256_loadu_si256((const __m256i*)(center + x)));
+        __m256i c = _mm256_cmpgt_epi8(zero, _mm256_loadu_si256((const __m256i*)(below + x)));
+        __m256i sum = _mm256_add_epi8(three, _mm256_add_epi8(a, _mm256_add_epi8(b, c)));
+        _mm256_storeu_si256((__m256i*)(votes + x), sum);
+    }
+    return x;
+}
+#endif
+
+// 统计三行中每一列的黑色像素数 (0-3)：votes[x] = [above[x] < 128] + [center[x] < 128] + [below[x] < 128]
+// 像素 < 128 等价于最高位为 0，因此按有符号字节比较 >= 0 即可一次处理 16/32 列
+inline void columnVotes(const uint8_t* above, const uint8_t* center, const uint8_t* below,
+    int width, uint8_t* votes) {
+    int x = 0;
+#ifdef SAMPLE_KERNEL_AVX2
+    if (width >= 32 && sampleKernelCpuHasAvx2()) {
+        x = columnVotesAvx2(above, center, below, width, votes);
+    }
+#endif
+#ifdef SAMPLE_KERNEL_SSE2
+    const __m128i three = _mm_set1_epi8(3);
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 16 <= width; x += 16) {
+        __m128i a = _mm_cmplt_epi8(_mm_loadu_si128((const __m128i*)(above + x)), zero);
+        __m128i b = _mm_cmplt_epi8(_mm_loadu_si128((const __m128i*)(center + x)), zero);
+        __m128i c = _mm_cmplt_epi8(_mm_loadu_si128((const __m128i*)(below + x)), zero);
+        __m128i sum = _mm_add_epi8(three, _mm_add_epi8(a, _mm_add_epi8(b, c)));
+        _mm_storeu_si128((__m128i*)(votes + x), sum);
+    }
+#endif
+    for (; x < width; ++x) {
+        votes[x] = uint8_t((above[x] < 128) + (center[x] < 128) + (below[x] < 128));
+    }
+}
+
+// 在已计算好列投票的行上采样一个模块：返回比特（中心点 < 128 为 1）并写出有效性
+inline bool sampleFromVotes(const uint8_t* votes, const uint8_t* center, int centerX, int offset,
+    const ValidityTable& table, uint8_t& validity) {
+    int vote = votes[centerX - offset] + votes[centerX] + votes[centerX + offset];
+    validity = table.value[vote];
+    return center[centerX] < 128;
+}
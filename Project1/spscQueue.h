@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// 有界单生产者单消费者无锁队列（流水线各级之间使用）：环形缓冲区，生产者只写 tail，消费者只写 head。
+// 队列满或空时 push / pop 让出 CPU 后重试；生产者 close 后消费者取完剩余元素即结束，
+// 消费者 cancel 后生产者的 push 立即返回 false
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity) : slots(capacity + 1) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // 队列满时返回 false，item 保持不变
+    bool tryPush(T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t next = (t + 1 == slots.size()) ? 0 : t + 1;
+        if (next == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        slots[t] = std::move(item);
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // 队列空时返回 false
+    bool tryPop(T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = std::move(slots[h]);
+        head.store((h + 1 == slots.size()) ? 0 : h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 阻塞写入；消费者已取消时返回 false
+    bool push(T item) {
+        while (!tryPush(item)) {
+            if (cancelled.load(std::memory_order_acquire)) {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    // 阻塞读取；队列已关闭且取空时返回 false
+    bool pop(T& item) {
+        while (!tryPop(item)) {
+            if (closed.load(std::memory_order_acquire)) {
+                // close 之前写入的元素此时一定可见
+                return tryPop(item);
+            }
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    // 生产者：不再写入
+    void close() {
+        closed.store(true, std::memory_order_release);
+    }
+
+    // 消费者：不再读取
+    void cancel() {
+        cancelled.store(true, std::memory_order_release);
+    }
+
+    bool isCancelled() const {
+        return cancelled.load(std::memory_order_acquire);
+    }
+
+private:
+    std::vector<T> slots;
+    alignas(64) std::atomic<size_t> head{ 0 };
+    alignas(64) std::atomic<size_t> tail{ 0 };
+    std::atomic<bool> closed{ false };
+    std::atomic<bool> cancelled{ false };
+};